@@ -0,0 +1,13 @@
+#pragma once
+#include <Arduino.h>
+
+// Аналоговый датчик уровня на A0 (0–1 В): медиана из N + IIR, только целочисленная математика.
+// Калибровка — кусочно-линейная таблица raw(0..1023) -> %.
+void analog_init();
+void analog_tick();
+
+bool     analog_enabled();
+uint32_t analog_next_sample_ms();
+uint16_t analog_raw();        // отфильтрованный отсчёт АЦП (для калибровки)
+uint16_t analog_permille();   // уровень, 0..1000 (десятые доли %)
+uint32_t analog_litres();     // по cfg.tank_litres
@@ -2,26 +2,50 @@
 #include <Arduino.h>
 #include "hardware.h"  // для значений по умолчанию D-пинов
 
+static const uint8_t ANALOG_CAL_MAX = 6;
+
 enum ControlMode : uint8_t { MODE_AUTO = 0, MODE_EXTERNAL = 1 };
 
 struct Config {
   // Идентификация / MQTT
   char     device_name[32] = "tank-sensor";
   char     base_topic[64]  = "home/tank";
+  char     group_topic[64] = "";         // общий префикс команд для группы ("" = выкл)
   char     mqtt_host[64]   = "";
   uint16_t mqtt_port       = 1883;
+  char     mqtt_fallback[128] = "";      // резервные брокеры "host[:port],..." по приоритету
+  uint16_t mqtt_failback_s = 300;        // hold-down до возврата на лучший брокер (0 = не возвращаться)
+  // TLS (BearSSL): пиннинг по CA из /mqtt_ca.pem, иначе по SHA1-отпечатку
+  bool     mqtt_tls        = false;
+  char     mqtt_fp[64]     = "";     // "AA:BB:..." или сплошной hex
+  uint16_t mqtt_tls_rx     = 2048;   // 512..16384; <16384 только если брокер умеет MFLN
+  uint16_t mqtt_tls_tx     = 1024;
+  // Профиль MQTT-транспорта
+  bool     mqtt_nodelay     = true;  // TCP_NODELAY
+  uint16_t mqtt_keepalive_s = 15;
+  uint16_t mqtt_timeout_s   = 5;     // таймаут сокета PubSubClient
+  uint16_t mqtt_buf         = 1024;  // буфер PubSubClient, выделяется при старте
+  uint16_t mqtt_ping_s      = 60;    // период замера RTT (0 = выкл)
   char     mqtt_user[32]   = "";
   char     mqtt_pass[32]   = "";
+  char     ntp_server[64]  = "pool.ntp.org";  // "" = без SNTP (ts в сообщениях = 0)
 
   // Web auth для /update (пусто = без авторизации)
   char     web_user[32]    = "";
   char     web_pass[32]    = "";
 
   // Сенсоры / дискретизация
-  uint32_t sample_ms       = 50;
+  uint32_t sample_ms       = 50;    // быстрый опрос: насос вкл / идёт подтверждение
+  uint32_t sample_idle_ms  = 500;   // медленный опрос в простое (0 = всегда sample_ms)
   uint8_t  confirm_samples = 3;
 
   ControlMode mode         = MODE_AUTO;
+  bool     low_power       = false;  // light sleep между задачами (только в AUTO)
+  bool     log_mqtt        = false;  // дублировать лог в <base>/debug
+
+  // Аппаратная отсечка перелива из прерывания (только AUTO)
+  bool     failsafe            = false;
+  uint16_t failsafe_confirm_ms = 20;   // датчик 100% активен столько мс подряд -> реле выкл
 
   // ---- Новые: настраиваемые пины и логика ----
   // Пины (используем Arduino-номера, например D1=5, D5=14, D7=13)
@@ -38,10 +62,62 @@ struct Config {
   bool     s50_pullup      = true;
   bool     s100_pullup     = true;
   bool     factory_pullup  = true;
+
+  // ---- Аналоговый датчик уровня (A0, 0–1 В) ----
+  bool     analog_enabled   = false;
+  uint16_t analog_sample_ms = 100;
+  uint8_t  analog_deadband  = 2;     // %, меньшие изменения не публикуются
+  uint32_t tank_litres      = 0;     // объём бака при 100% (0 = не публиковать литры)
+  uint8_t  pump_start_pct   = 20;    // AUTO: включить насос ниже порога
+  uint8_t  pump_stop_pct    = 95;    // AUTO: выключить насос на/выше порога
+  // Калибровка: точки raw(АЦП) -> %, raw строго возрастает
+  uint8_t  analog_cal_n     = 2;
+  uint16_t analog_cal_raw[ANALOG_CAL_MAX] = {0, 1023};
+  uint8_t  analog_cal_pct[ANALOG_CAL_MAX] = {0, 100};
 };
 
 extern Config cfg;
 
+// ---- Схема конфигурации: одна таблица полей на JSON load/save, форму /settings и её разбор ----
+enum CfgType : uint8_t {
+  CF_STR,    // char[N]
+  CF_UINT,   // беззнаковое 1/2/4 байта (по sizeof), границы min..max
+  CF_BOOL,
+  CF_PIN,    // GPIO, только из списка cfgPinValid()
+  CF_MODE,   // ControlMode: "auto" / "external"
+  CF_CAL,    // таблица калибровки analog_cal_* (JSON [[raw,pct],..], форма "raw:pct,...")
+};
+enum CfgSection : uint8_t { CS_MQTT, CS_PINS, CS_ANALOG, CS_COUNT };
+enum CfgBoolText : uint8_t { CB_ON_OFF, CB_HIGH_LOW, CB_PULLUP_NONE };
+enum CfgFlags : uint8_t {
+  CFF_SECRET   = 1,  // в форму не выводится, пусто — без изменений
+  CFF_EMPTY_OK = 2,  // пустая строка — допустимое значение (иначе пусто = без изменений)
+};
+
+// Таблица и её строки лежат во флеш (PROGMEM): поле читать через cfgField(),
+// key/label/hint — только через FPSTR()/strcmp_P()/pgm_read_byte()
+struct CfgField {
+  const char* key;      // имя в JSON и в форме
+  uint16_t    offset;   // offsetof(Config, ...)
+  uint8_t     size;
+  CfgType     type;
+  CfgSection  section;
+  uint8_t     flags;
+  uint8_t     text;     // CfgBoolText для CF_BOOL
+  uint32_t    min, max; // CF_UINT: вне границ — clamp; 0 при min > 0 — значение по умолчанию; CF_CAL: точек
+  const char* label;
+  const char* hint;     // подсказка под полем ("" — нет)
+};
+
+extern const CfgField CONFIG_FIELDS[];
+extern const uint8_t  CONFIG_FIELDS_N;
+CfgField cfgField(uint8_t i);           // копия строки таблицы из флеш
+
+bool   cfgPinValid(uint8_t pin);
+String cfgFieldText(const CfgField& f, const Config& c);               // значение для формы
+void   cfgFieldParse(const CfgField& f, Config& c, const String& v);   // из формы, с проверкой границ
+void   cfgValidate(Config& c);                                          // перекрёстные правила полей
+
 bool loadConfig();
 bool saveConfig();
 
@@ -0,0 +1,15 @@
+#pragma once
+#include <Arduino.h>
+
+// Аппаратная отсечка перелива (AUTO + cfg.failsafe): опрос датчика 100% из прерывания timer1
+// (общий с PWM через setTimer1Callback), после cfg.failsafe_confirm_ms подряд — реле выкл
+// прямо из ISR. Флаг защёлкивается и снимается в loop() после сверки с антидребезгом.
+void failsafe_init(uint8_t pin100, bool true_high100);
+void failsafe_loop();             // армирование по режиму + сверка защёлки
+void failsafe_on_edge_isr();      // фронт на входе 100% (из ISR датчиков) — отметка времени
+void failsafe_force(bool on);     // армировать независимо от cfg.failsafe (насос включён до старта loop())
+
+bool     failsafe_latched();      // реле удерживается выключенным
+uint32_t failsafe_trips();
+uint32_t failsafe_last_us();      // фронт -> реле выкл, последняя отсечка
+uint32_t failsafe_worst_us();     // худший случай с момента старта
@@ -0,0 +1,22 @@
+#pragma once
+#include <Arduino.h>
+
+// Прямой доступ к регистрам GPIO ESP8266: пин и полярность — параметры шаблона,
+// чтение сводится к сдвигу/маске без digitalRead() и ветвлений по конфигу.
+template <uint8_t PIN, bool TRUE_HIGH>
+struct FastIn {
+  static_assert(PIN <= 16, "ESP8266: GPIO 0..16");
+  static inline bool read() {
+    uint32_t v = (PIN == 16) ? (GP16I & 1) : ((GPI >> PIN) & 1);
+    return v ^ !TRUE_HIGH;
+  }
+};
+
+template <uint8_t PIN>
+struct FastOut {
+  static_assert(PIN <= 16, "ESP8266: GPIO 0..16");
+  static inline void write(bool high) {
+    if (PIN == 16) GP16O = high;
+    else           *(high ? &GPOS : &GPOC) = (1UL << PIN);
+  }
+};
@@ -9,3 +9,23 @@ static const uint8_t LED_PIN       = LED_BUILTIN; // активен по LOW
 
 static const uint8_t FACTORY_PIN   = D7;  // удерживать LOW ~5 c при старте
 static const unsigned long FACTORY_HOLD_MS = 5000;
+
+// Сборка под фиксированное железо (-DFIXED_HW): пины/полярность датчиков и реле
+// зашиты в код, настройки пинов из config.json для них игнорируются.
+#ifdef FIXED_HW
+#ifndef FIXED_PIN_S50
+#define FIXED_PIN_S50    14  // D5
+#endif
+#ifndef FIXED_PIN_S100
+#define FIXED_PIN_S100   5   // D1
+#endif
+#ifndef FIXED_PIN_RELAY
+#define FIXED_PIN_RELAY  4   // D2
+#endif
+#ifndef FIXED_S50_HIGH
+#define FIXED_S50_HIGH   1
+#endif
+#ifndef FIXED_S100_HIGH
+#define FIXED_S100_HIGH  1
+#endif
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+
+// Табличный движок LED-паттернов: волны в PROGMEM, фиксированная частота кадров,
+// запись в пин только при смене скважности.
+enum LedState : uint8_t {
+  LED_OFF = 0,      // бак пуст
+  LED_LEVEL50,      // >=50%
+  LED_LEVEL100,     // 100%
+  LED_ERROR,        // 100% без 50%
+  LED_WIFI_DOWN,
+  LED_MQTT_DOWN,
+  LED_OTA,
+  LED_STATE_COUNT
+};
+
+struct LedPattern {
+  const uint8_t* wave;   // PROGMEM, яркость 0..255 (255 = горит)
+  uint8_t  len;
+  uint16_t step_ms;      // длительность одного шага таблицы
+};
+
+void led_init(uint8_t pin);
+void led_register(LedState st, const LedPattern* p);   // заменить паттерн состояния
+void led_set_state(LedState st);
+void led_tick(uint32_t now_ms);
+
+uint32_t led_frame_cycles();   // средняя стоимость кадра, тактов CPU (EWMA)
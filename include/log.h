@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+
+// Лог с отсечкой уровней на этапе компиляции и бинарным кольцевым буфером в RAM.
+// В буфер пишется только {ms, уровень, указатель на формат в PROGMEM, до 4 аргументов};
+// форматирование — отложенное, при чтении (/log, Serial, MQTT debug).
+// Аргументы — целые или указатели на строки-литералы (не временные String!).
+
+#define LOG_LVL_NONE  0
+#define LOG_LVL_ERROR 1
+#define LOG_LVL_WARN  2
+#define LOG_LVL_INFO  3
+#define LOG_LVL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LVL_INFO
+#endif
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 64
+#endif
+#ifndef LOG_SERIAL
+#define LOG_SERIAL 1
+#endif
+
+static const uint8_t LOG_MAX_ARGS = 4;
+
+void log_push(uint8_t level, PGM_P fmt, const uint32_t* args, uint8_t n);
+
+template <typename... A>
+inline void log_write(uint8_t level, PGM_P fmt, A... a) {
+  static_assert(sizeof...(A) <= LOG_MAX_ARGS, "log: не больше 4 аргументов");
+  const uint32_t v[LOG_MAX_ARGS + 1] = { (uint32_t)(uintptr_t)a... };   // uintptr_t — и для хостовой сборки (test/host)
+  log_push(level, fmt, v, sizeof...(A));
+}
+
+#if LOG_LEVEL >= LOG_LVL_ERROR
+#define LOGE(fmt, ...) log_write(LOG_LVL_ERROR, PSTR(fmt), ##__VA_ARGS__)
+#else
+#define LOGE(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LVL_WARN
+#define LOGW(fmt, ...) log_write(LOG_LVL_WARN, PSTR(fmt), ##__VA_ARGS__)
+#else
+#define LOGW(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LVL_INFO
+#define LOGI(fmt, ...) log_write(LOG_LVL_INFO, PSTR(fmt), ##__VA_ARGS__)
+#else
+#define LOGI(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LVL_DEBUG
+#define LOGD(fmt, ...) log_write(LOG_LVL_DEBUG, PSTR(fmt), ##__VA_ARGS__)
+#else
+#define LOGD(fmt, ...) do {} while (0)
+#endif
+
+uint32_t log_head();                                   // номер следующей записи
+uint32_t log_tail();                                   // самая старая запись, ещё лежащая в буфере
+bool     log_format(uint32_t seq, char* buf, size_t len);
+void     log_loop();                                   // вывод новых записей в Serial (LOG_SERIAL)
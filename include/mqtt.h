@@ -1,9 +1,43 @@
 #pragma once
 #include <Arduino.h>
 
+// Счётчики MQTT-пути — базовая линия для сравнения изменений (/mqtt/stats)
+struct MqttStats {
+  uint32_t connects          = 0;
+  uint32_t connect_fails     = 0;
+  uint32_t connect_ms        = 0;  // TCP + CONNECT/CONNACK, последнее подключение
+  uint32_t first_state_ms    = 0;  // от начала connect() до первого стейта
+  uint32_t outage_ms         = 0;  // последний разрыв: потеря связи -> снова online
+  uint32_t discovery_packets = 0;  // последний анонс
+  uint32_t discovery_bytes   = 0;
+  uint32_t publishes         = 0;  // всего с момента старта
+  uint32_t publish_bytes     = 0;  // байт на проводе (заголовок MQTT + topic + payload)
+  uint32_t publish_fails     = 0;
+  uint32_t rtt_last_ms       = 0;  // петлевой пинг через брокер (<base>/ping)
+  uint32_t rtt_avg_ms        = 0;  // EWMA 1/8
+  uint32_t rtt_max_ms        = 0;
+  uint32_t pings_lost        = 0;
+  uint32_t tls_full          = 0;  // полных TLS-рукопожатий
+  uint32_t tls_resumed       = 0;  // возобновлённых по кэшированной сессии
+  uint32_t tls_full_ms       = 0;  // последнее полное рукопожатие (TCP + TLS)
+  uint32_t tls_resumed_ms    = 0;  // последнее возобновлённое
+  bool     tls_mfln          = false;  // брокер принял уменьшенный фрагмент (mqtt_tls_rx)
+  uint32_t broker            = 0;  // индекс текущего брокера (0 = mqtt_host)
+  uint32_t failovers         = 0;  // переходов на другой брокер
+  uint32_t failover_ms       = 0;  // последний переход: потеря связи -> online на новом брокере
+};
+
+static const char* const MQTT_CA_PATH = "/mqtt_ca.pem";
+
 void mqtt_init();
 void mqtt_loop();
 bool mqtt_online();
+String mqtt_broker();                   // "host:port" текущего/последнего брокера
+const MqttStats& mqtt_stats();
+// seq у каждого топика свой: пропуск в <base>/state или <base>/attributes — потеря именно там
+uint32_t mqtt_seq_state();              // последний seq в <base>/state
+uint32_t mqtt_seq_attr();               // последний seq в <base>/attributes
+void     mqtt_seq_restore(uint32_t state_seq, uint32_t attr_seq);  // продолжить нумерацию после тёплого рестарта
 
 void mqtt_reannounce();     // discovery + актуальные стейты (ручной вызов)
 void mqtt_publish_all();    // полный пакет (используем только при первом коннекте/реанонсе)
@@ -0,0 +1,11 @@
+#pragma once
+#include <Arduino.h>
+
+// Режим пониженного потребления (только cfg.low_power && MODE_AUTO):
+// Wi-Fi light sleep + сон между плановыми задачами, пробуждение по фронту датчика.
+void power_init();
+void power_idle(uint32_t next_due_ms);   // вызывать в конце loop(): спит до next_due_ms (или до фронта)
+
+bool     power_active();
+uint8_t  power_awake_pct();              // доля времени бодрствования с момента старта, %
+uint32_t power_est_ua();                 // оценка среднего тока, мкА
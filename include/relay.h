@@ -4,3 +4,4 @@
 void relay_init(uint8_t pin);
 void relay_set(bool on);
 bool relay_get();
+void relay_off_isr();   // IRAM, для отсечки из прерывания
@@ -0,0 +1,26 @@
+#pragma once
+#include <Arduino.h>
+
+// Снимок управления в RTC user memory (переживает soft/ext reset, но не снятие питания).
+// При тёплом старте позволяет продолжить управление без «холодного» цикла датчиков/реле.
+// Сбой (WDT/exception) — всегда холодный старт: цикл падений не должен раз за разом включать насос.
+struct RtcSnapshot {
+  uint32_t magic;
+  uint8_t  s50;
+  uint8_t  s100;
+  uint8_t  relay;
+  uint8_t  mode;
+  uint32_t warm_boots;   // тёплых стартов с последнего холодного
+  uint32_t seq_state;    // seq <base>/state — монотонен через тёплые рестарты
+  uint32_t seq_attr;     // seq <base>/attributes
+  uint32_t crc;          // crc32 всего, что выше
+};
+
+bool rtcstate_begin();                  // true — тёплый старт с валидным снимком (вызывать после LittleFS.begin)
+const RtcSnapshot& rtcstate_saved();
+void rtcstate_loop();                   // пишет снимок в RTC, только если он изменился
+void rtcstate_invalidate();             // перед заводским сбросом
+
+bool     rtcstate_warm();
+uint32_t rtcstate_warm_boots();
+uint32_t rtcstate_cold_boots();         // хранится в LittleFS (/boots)
@@ -4,13 +4,20 @@
 // Инициализация с учётом инверсии/подтяжки
 void sensors_init(uint8_t pin50, bool true_high50, bool pullup50,
                   uint8_t pin100, bool true_high100, bool pullup100,
-                  uint8_t led_pin, uint32_t sample_ms, uint8_t confirm_samples);
+                  uint32_t sample_ms, uint32_t idle_ms, uint8_t confirm_samples);
 
 void sensors_tick();
+void sensors_set_active(bool active);        // насос работает -> быстрый опрос
+void sensors_restore(bool s50, bool s100);   // тёплый старт: подтверждённые состояния из RTC
+uint32_t sensors_next_sample_ms();  // millis() следующего планового отсчёта
+bool     sensors_edge_pending();    // был фронт на входе (ISR), отсчёт ещё не снят
+uint32_t sensors_sample_cycles();   // средняя стоимость отсчёта, тактов CPU
+uint32_t sensors_period_ms();       // текущий период опроса (адаптивный)
+uint16_t sensors_rate_x10();        // фактических отсчётов за последние 10 c (= Гц * 10)
+uint32_t sensors_confirm_ms(bool active);        // последняя задержка подтверждения: насос вкл / простой
+void     sensors_set_edge100_hook(void (*fn)());   // вызывается из ISR на фронте входа 100% (IRAM!)
 
 bool sensors_s50();
 bool sensors_s100();
 int  sensors_level();   // 0/50/100
 bool sensors_error();   // 100% без 50% — ошибка
-
-void sensors_led_tick(uint32_t now_ms);
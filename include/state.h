@@ -0,0 +1,26 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Единый срез состояния для MQTT, web и лога. Обновляется в одном месте — state_update()
+// из loop() после управления насосом; любое изменение полей увеличивает version.
+// Потребители сравнивают version и переиспользуют сериализации, собранные под неё.
+struct State {
+  uint32_t    version   = 0;
+  uint8_t     level     = 0;      // 0 / 50 / 100
+  bool        error     = false;
+  bool        s50       = false;
+  bool        s100      = false;
+  bool        relay     = false;
+  ControlMode mode      = MODE_AUTO;
+  bool        analog    = false;  // аналоговый датчик включён
+  uint16_t    analog_pm = 0;      // ‰, меняется только за пределами analog_deadband
+  uint32_t    litres    = 0;
+  int8_t      rssi      = 0;      // dBm, раз в секунду, версию не меняет
+};
+
+void          state_update();
+const State&  state();
+const String& state_json();       // {"level","error","relay","mode"[,"analog"]} — кэш на версию
+
+inline const char* state_mode_str(ControlMode m) { return m == MODE_EXTERNAL ? "external" : "auto"; }
@@ -0,0 +1,14 @@
+#pragma once
+#include <Arduino.h>
+
+// SNTP-синхронизация с оценкой ухода millis() относительно NTP.
+void timesync_init();
+
+bool     timesync_synced();
+uint32_t timesync_syncs();
+uint32_t timesync_age_s();          // с последней синхронизации
+int32_t  timesync_offset_ms();      // поправка при последней синхронизации (NTP - прогноз по millis)
+int32_t  timesync_drift_ppm();      // уход кварца по последнему интервалу
+
+// Печатает epoch в мс в buf как десятичное число ("0" если нет синхронизации)
+void timesync_format_ms(char* buf, size_t len);
@@ -3,3 +3,4 @@
 
 void web_init();
 void web_loop();
+bool web_ota_active();   // идёт запись прошивки (асинхронный сервер не останавливает loop())
@@ -0,0 +1,34 @@
+#pragma once
+// СГЕНЕРИРОВАНО tools/gen_web_assets.py — не править руками.
+#include <Arduino.h>
+
+// web/style.css: 661 B -> gzip 384 B
+static const char STYLE_CSS_URL[]  = "/style.css";
+static const char STYLE_CSS_VER[]  = "0c899a9d";  // ETag и ?v= в ссылке
+static const size_t STYLE_CSS_GZ_LEN = 384;
+static const uint8_t STYLE_CSS_GZ[] PROGMEM = {
+  0x1f,0x8b,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0x6d,0x92,0xd1,0x6e,0x84,0x20,
+  0x10,0x45,0x7f,0xc5,0x64,0xd3,0xa4,0x4d,0xd4,0xa0,0xdb,0x9a,0x16,0x9e,0xfa,0x29,
+  0x23,0x8c,0x4a,0x8a,0x60,0x06,0xec,0xae,0x31,0xfe,0x7b,0x91,0xee,0xb6,0xdb,0x4d,
+  0x5f,0x0c,0x0e,0x73,0x99,0x7b,0x0f,0xb4,0x4e,0x2d,0x6b,0xe7,0x6c,0x28,0x3a,0x18,
+  0xb5,0x59,0xb8,0x5f,0x7c,0xc0,0xb1,0x98,0x75,0xfe,0x4e,0x1a,0x8c,0x18,0x81,0x7a,
+  0x6d,0x79,0x4d,0x38,0xc6,0xf5,0xb9,0x38,0x69,0x15,0x06,0xfe,0xda,0xb0,0xe9,0xbc,
+  0xc1,0x2a,0x9d,0x71,0xc4,0x0f,0xac,0xe9,0x44,0xc0,0x73,0x28,0x14,0x4a,0x47,0x10,
+  0xb4,0xb3,0xdc,0x3a,0x8b,0x5b,0x06,0x7c,0x70,0x9f,0x48,0xeb,0xfd,0xee,0x6c,0x15,
+  0x92,0xd1,0xb1,0x45,0x3a,0x85,0x6b,0x0b,0xf2,0xa3,0x27,0x17,0xab,0xfc,0x80,0x88,
+  0x62,0x02,0xa5,0xb4,0xed,0x79,0x59,0xc5,0xb9,0x59,0x79,0xdc,0xa7,0xb7,0x8e,0xa2,
+  0xa6,0x20,0x50,0x7a,0xf6,0x3c,0xd5,0x36,0x6d,0xa7,0x39,0xe4,0x1e,0x0d,0xca,0x90,
+  0xef,0x33,0x80,0x10,0xd6,0x1f,0xf5,0x73,0x52,0xbf,0xfc,0xaa,0x79,0x35,0x9d,0x33,
+  0xef,0x8c,0x56,0xd9,0x41,0x4a,0x79,0x7f,0x66,0xea,0xfc,0x4e,0x58,0x31,0xf6,0x70,
+  0x13,0xf8,0x98,0x02,0x1b,0x68,0xd1,0xac,0x4a,0xfb,0xc9,0xc0,0xc2,0x5b,0xe3,0xe4,
+  0xc7,0x15,0x50,0xd2,0x66,0x2c,0x2b,0x13,0xa9,0x44,0xf4,0x84,0xba,0x1f,0x02,0x6f,
+  0x18,0xdb,0xda,0x39,0x04,0x67,0x6f,0x8c,0xa5,0xee,0xf2,0xf5,0x9f,0x5c,0xcd,0x8d,
+  0x5b,0x26,0x6e,0xc1,0xd4,0x75,0x2d,0x2e,0xc0,0xbb,0xae,0x13,0x72,0x26,0x1f,0xd7,
+  0x93,0xd3,0x36,0x20,0x5d,0x46,0x94,0x3e,0x32,0xb6,0x0a,0x68,0xf9,0xc3,0xb4,0x69,
+  0x9a,0xad,0x24,0x77,0x5a,0xaf,0x6e,0x9b,0xe4,0x76,0x2b,0x7b,0xd2,0xea,0x27,0xd0,
+  0xfe,0x23,0xf6,0x4f,0x11,0x9f,0x40,0xac,0x04,0x2c,0xe2,0xbc,0x79,0xb4,0x9e,0x13,
+  0x4e,0x08,0xe1,0x11,0xe6,0xe0,0x8a,0x4e,0x87,0x7c,0xd4,0x36,0xc2,0x79,0xac,0x77,
+  0x2c,0x79,0xd5,0xd1,0xd3,0x93,0xe8,0x61,0xe2,0x55,0x1d,0x29,0x95,0x03,0xad,0xc3,
+  0x77,0xf6,0x88,0x5b,0xdc,0xdf,0xed,0xc5,0x42,0x75,0x71,0x70,0x02,0xb2,0xd7,0x77,
+  0xd4,0x3e,0xbf,0x1c,0xd9,0xdb,0xf6,0x05,0x89,0xc9,0x7a,0x75,0x95,0x02,0x00,0x00,
+};
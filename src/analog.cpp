@@ -0,0 +1,71 @@
+#include "analog.h"
+#include "config.h"
+
+static const uint8_t MEDIAN_N  = 5;
+static const uint8_t IIR_SHIFT = 3;   // y += (x - y) / 8
+
+static uint16_t s_win[MEDIAN_N];
+static uint8_t  s_win_pos  = 0;
+static uint8_t  s_win_fill = 0;
+static int32_t  s_filt_q8  = -1;      // Q8, -1 = ещё нет отсчётов
+static uint16_t s_permille = 0;
+static uint32_t t_next     = 0;
+
+static uint16_t median() {
+  uint16_t v[MEDIAN_N];
+  uint8_t n = s_win_fill;
+  for (uint8_t i = 0; i < n; i++) {           // вставками — N маленькое
+    uint16_t x = s_win[i]; int8_t j = i - 1;
+    while (j >= 0 && v[j] > x) { v[j+1] = v[j]; j--; }
+    v[j+1] = x;
+  }
+  return v[n / 2];
+}
+
+// Кусочно-линейная интерполяция по таблице калибровки, x в Q8
+static uint16_t mapPermille(int32_t x_q8) {
+  uint8_t n = cfg.analog_cal_n;
+  if (n < 2) return 0;
+  const uint16_t* r = cfg.analog_cal_raw;
+  const uint8_t*  p = cfg.analog_cal_pct;
+  if (x_q8 <= ((int32_t)r[0] << 8))   return p[0] * 10;
+  if (x_q8 >= ((int32_t)r[n-1] << 8)) return p[n-1] * 10;
+  uint8_t i = 0;
+  while (i + 2 < n && x_q8 >= ((int32_t)r[i+1] << 8)) i++;
+  int32_t dr = ((int32_t)r[i+1] - r[i]) << 8;
+  if (dr <= 0) return p[i] * 10;
+  int32_t dp = ((int32_t)p[i+1] - p[i]) * 10;
+  int32_t v  = p[i] * 10 + (x_q8 - ((int32_t)r[i] << 8)) * dp / dr;
+  if (v < 0) v = 0;
+  if (v > 1000) v = 1000;
+  return (uint16_t)v;
+}
+
+void analog_init() {
+  s_win_pos = s_win_fill = 0;
+  s_filt_q8 = -1;
+  t_next = millis();
+}
+
+void analog_tick() {
+  if (!cfg.analog_enabled) return;
+  uint32_t now = millis();
+  if ((int32_t)(now - t_next) < 0) return;
+  t_next = now + cfg.analog_sample_ms;
+
+  s_win[s_win_pos] = (uint16_t)analogRead(A0);
+  s_win_pos = (s_win_pos + 1) % MEDIAN_N;
+  if (s_win_fill < MEDIAN_N) s_win_fill++;
+
+  int32_t x_q8 = (int32_t)median() << 8;
+  if (s_filt_q8 < 0) s_filt_q8 = x_q8;
+  else               s_filt_q8 += (x_q8 - s_filt_q8) >> IIR_SHIFT;
+
+  s_permille = mapPermille(s_filt_q8);
+}
+
+bool     analog_enabled()        { return cfg.analog_enabled && s_filt_q8 >= 0; }
+uint32_t analog_next_sample_ms() { return t_next; }
+uint16_t analog_raw()            { return s_filt_q8 < 0 ? 0 : (uint16_t)((s_filt_q8 + 128) >> 8); }
+uint16_t analog_permille()       { return s_permille; }
+uint32_t analog_litres()         { return (uint32_t)s_permille * cfg.tank_litres / 1000; }
@@ -1,11 +1,238 @@
 #include <ArduinoJson.h>
 #include <LittleFS.h>
+#include <stddef.h>
 #include "config.h"
 
 Config cfg;
 const char* CFG_PATH = "/config.json";
 
-bool loadConfig() {
+// Новое поле настроек — одна строка в CONFIG_FIELD_LIST: JSON, форма и проверка берутся из таблицы.
+// Список раскрывается дважды: строки (ключ, подпись, подсказка), затем сама таблица — всё во флеш.
+#define CONFIG_FIELD_LIST \
+  CFG_STR (CS_MQTT, device_name,   0,            "Device name")                                                       \
+  CFG_STR (CS_MQTT, base_topic,    0,            "Base topic")                                                        \
+  CFG_STR (CS_MQTT, group_topic,   CFF_EMPTY_OK, "Group topic (общие команды, пусто — выкл)")                         \
+  CFG_STR (CS_MQTT, mqtt_host,     0,            "MQTT host")                                                         \
+  CFG_UINT(CS_MQTT, mqtt_port,     1, 65535,     "MQTT port")                                                         \
+  CFG_STR (CS_MQTT, mqtt_fallback, CFF_EMPTY_OK, "Fallback brokers (host[:port],… по приоритету)")                    \
+  CFG_UINT(CS_MQTT, mqtt_failback_s, 0, 65535,   "Failback hold-down, s (0 — не возвращаться)")                       \
+  CFG_BOOL(CS_MQTT, mqtt_tls,      CB_ON_OFF,    "TLS (обычно порт 8883)", "")                                        \
+  CFG_STR (CS_MQTT, mqtt_fp,       CFF_EMPTY_OK, "TLS fingerprint SHA1 (если нет CA)")                                \
+  CFG_UINT(CS_MQTT, mqtt_tls_rx,   512, 16384,   "TLS rx buffer, B (512..16384)")                                     \
+  CFG_UINT(CS_MQTT, mqtt_tls_tx,   512, 16384,   "TLS tx buffer, B")                                                  \
+  CFG_STR (CS_MQTT, ntp_server,    CFF_EMPTY_OK, "NTP server (пусто — выкл)")                                         \
+  CFG_BOOL(CS_MQTT, mqtt_nodelay,  CB_ON_OFF,    "TCP_NODELAY", "")                                                   \
+  CFG_UINT(CS_MQTT, mqtt_keepalive_s, 5, 600,    "Keep-alive, s")                                                     \
+  CFG_UINT(CS_MQTT, mqtt_timeout_s,   1, 60,     "Socket timeout, s")                                                 \
+  CFG_UINT(CS_MQTT, mqtt_buf,      256, 8192,    "MQTT buffer, B")                                                    \
+  CFG_UINT(CS_MQTT, mqtt_ping_s,   0, 3600,      "RTT ping, s (0 — выкл)")                                            \
+  CFG_STR (CS_MQTT, mqtt_user,     0,            "MQTT user")                                                         \
+  CFG_STR (CS_MQTT, mqtt_pass,     CFF_SECRET,   "MQTT password (оставь пустым — без изменений)")                     \
+  CFG_MODE(CS_MQTT, mode,          "Mode")                                                                            \
+  CFG_BOOL(CS_MQTT, low_power,     CB_ON_OFF,    "Low-power (только AUTO)", "")                                       \
+  CFG_BOOL(CS_MQTT, log_mqtt,      CB_ON_OFF,    "Log → MQTT (&lt;base&gt;/debug)", "")                               \
+  CFG_BOOL(CS_MQTT, failsafe,      CB_ON_OFF,    "Failsafe: отсечка из прерывания (AUTO)", "")                        \
+  CFG_UINT(CS_MQTT, failsafe_confirm_ms, 1, 1000, "failsafe_confirm_ms")                                              \
+  CFG_UINT(CS_MQTT, sample_ms,     1, 60000,     "sample_ms")                                                         \
+  CFG_UINT(CS_MQTT, sample_idle_ms, 0, 600000,   "sample_idle_ms (простой, 0 — выкл)")                                \
+  CFG_UINT(CS_MQTT, confirm_samples, 1, 50,      "confirm_samples")                                                   \
+  CFG_STR (CS_MQTT, web_user,      0,            "Web auth user (/update)")                                           \
+  CFG_STR (CS_MQTT, web_pass,      CFF_SECRET,   "Web auth pass (оставь пустым — без изменений)")                     \
+                                                                                                                      \
+  CFG_PIN (CS_PINS, pin_sensor50,  "Sensor 50% pin")                                                                  \
+  CFG_BOOL(CS_PINS, s50_true_high, CB_HIGH_LOW,  "Sensor 50% TRUE when", "")                                          \
+  CFG_BOOL(CS_PINS, s50_pullup,    CB_PULLUP_NONE, "Sensor 50% pull", "ESP8266 не поддерживает INPUT_PULLDOWN")       \
+  CFG_PIN (CS_PINS, pin_sensor100, "Sensor 100% pin")                                                                 \
+  CFG_BOOL(CS_PINS, s100_true_high, CB_HIGH_LOW, "Sensor 100% TRUE when", "")                                         \
+  CFG_BOOL(CS_PINS, s100_pullup,   CB_PULLUP_NONE, "Sensor 100% pull", "Избегай D3/D4/D8 если не уверен (boot-пины)") \
+  CFG_PIN (CS_PINS, pin_factory,   "Factory/Reset pin")                                                               \
+  CFG_BOOL(CS_PINS, factory_true_high, CB_HIGH_LOW, "Factory active when", "")                                        \
+  CFG_BOOL(CS_PINS, factory_pullup, CB_PULLUP_NONE, "Factory pull", "Для активного LOW обычно выбирают PULLUP")       \
+                                                                                                                      \
+  CFG_BOOL(CS_ANALOG, analog_enabled, CB_ON_OFF, "Analog sensor", "")                                                 \
+  CFG_UINT(CS_ANALOG, analog_sample_ms, 10, 60000, "analog_sample_ms")                                                \
+  CFG_UINT(CS_ANALOG, analog_deadband, 0, 100,   "Deadband, %")                                                       \
+  CFG_UINT(CS_ANALOG, tank_litres,  0, 1000000,  "Tank volume, L (0 — не публиковать)")                               \
+  CFG_UINT(CS_ANALOG, pump_start_pct, 0, 100,    "AUTO: pump start below, %")                                         \
+  CFG_UINT(CS_ANALOG, pump_stop_pct,  0, 100,    "AUTO: pump stop at, %")                                             \
+  CFG_CAL (CS_ANALOG, analog_cal, analog_cal_n, "Calibration raw:% (через запятую)", "raw 0..1023 по возрастанию")
+
+#define CFG_STRINGS(f, label, hint) \
+  static const char CFK_##f[] PROGMEM = #f; static const char CFL_##f[] PROGMEM = label; static const char CFH_##f[] PROGMEM = hint;
+#define CFG_STR(sec, f, flags, label)       CFG_STRINGS(f, label, "")
+#define CFG_UINT(sec, f, lo, hi, label)     CFG_STRINGS(f, label, "")
+#define CFG_BOOL(sec, f, text, label, hint) CFG_STRINGS(f, label, hint)
+#define CFG_PIN(sec, f, label)              CFG_STRINGS(f, label, "")
+#define CFG_MODE(sec, f, label)             CFG_STRINGS(f, label, "")
+#define CFG_CAL(sec, f, m, label, hint)     CFG_STRINGS(f, label, hint)
+CONFIG_FIELD_LIST
+#undef CFG_STR
+#undef CFG_UINT
+#undef CFG_BOOL
+#undef CFG_PIN
+#undef CFG_MODE
+#undef CFG_CAL
+
+#define CFG_ROW(f, m, type, sec, flags, text, lo, hi) \
+  { CFK_##f, offsetof(Config, m), sizeof(Config::m), type, sec, flags, text, lo, hi, CFL_##f, CFH_##f },
+#define CFG_STR(sec, f, flags, label)       CFG_ROW(f, f, CF_STR,  sec, flags, 0, 0, 0)
+#define CFG_UINT(sec, f, lo, hi, label)     CFG_ROW(f, f, CF_UINT, sec, 0, 0, lo, hi)
+#define CFG_BOOL(sec, f, text, label, hint) CFG_ROW(f, f, CF_BOOL, sec, 0, text, 0, 1)
+#define CFG_PIN(sec, f, label)              CFG_ROW(f, f, CF_PIN,  sec, 0, 0, 0, 16)
+#define CFG_MODE(sec, f, label)             CFG_ROW(f, f, CF_MODE, sec, 0, 0, 0, 1)
+#define CFG_CAL(sec, f, m, label, hint)     CFG_ROW(f, m, CF_CAL,  sec, 0, 0, 2, ANALOG_CAL_MAX)   // min/max — число точек
+
+extern constexpr CfgField CONFIG_FIELDS[] PROGMEM = { CONFIG_FIELD_LIST };
+extern constexpr uint8_t CONFIG_FIELDS_N = sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]);
+
+CfgField cfgField(uint8_t i) {
+  CfgField f;
+  memcpy_P(&f, &CONFIG_FIELDS[i], sizeof(f));
+  return f;
+}
+
+static uint8_t* at(Config& c, const CfgField& f)             { return (uint8_t*)&c + f.offset; }
+static const uint8_t* at(const Config& c, const CfgField& f) { return (const uint8_t*)&c + f.offset; }
+
+static uint32_t getUint(const CfgField& f, const Config& c) {
+  const uint8_t* p = at(c, f);
+  switch (f.size) {
+    case 1:  return *p;
+    case 2:  return *(const uint16_t*)p;
+    default: return *(const uint32_t*)p;
+  }
+}
+
+// Единственное место проверки чисел: и для JSON, и для формы
+static void setUint(const CfgField& f, Config& c, uint32_t v) {
+  if (v == 0 && f.min > 0) { Config def; v = getUint(f, def); }   // редкий путь: временный Config на стеке
+  v = constrain(v, f.min, f.max);
+  uint8_t* p = at(c, f);
+  switch (f.size) {
+    case 1:  *p = (uint8_t)v; break;
+    case 2:  *(uint16_t*)p = (uint16_t)v; break;
+    default: *(uint32_t*)p = v; break;
+  }
+}
+
+bool cfgPinValid(uint8_t pin) {
+  // D0..D8 NodeMCU; GPIO 1/3 (UART) и 6..11 (flash) не выдаём
+  switch (pin) { case 0: case 2: case 4: case 5: case 12: case 13: case 14: case 15: case 16: return true; }
+  return false;
+}
+
+// Принимает таблицу калибровки, только если raw строго возрастает и % <= 100
+static bool calSet(Config& c, const uint16_t* raw, const uint8_t* pct, uint8_t n) {
+  if (n < 2 || n > ANALOG_CAL_MAX) return false;   // те же границы, что min/max поля analog_cal
+  for (uint8_t i = 0; i < n; i++) {
+    if (raw[i] > 1023 || pct[i] > 100) return false;
+    if (i && raw[i] <= raw[i-1]) return false;
+  }
+  for (uint8_t i = 0; i < n; i++) { c.analog_cal_raw[i] = raw[i]; c.analog_cal_pct[i] = pct[i]; }
+  c.analog_cal_n = n;
+  return true;
+}
+
+String cfgFieldText(const CfgField& f, const Config& c) {
+  switch (f.type) {
+    case CF_STR:  return (f.flags & CFF_SECRET) ? String() : String((const char*)at(c, f));
+    case CF_UINT: return String(getUint(f, c));
+    case CF_BOOL: return *(const bool*)at(c, f) ? "1" : "0";
+    case CF_PIN:  return String(*at(c, f));
+    case CF_MODE: return c.mode == MODE_EXTERNAL ? "external" : "auto";
+    case CF_CAL: {
+      String s;
+      for (uint8_t i = 0; i < c.analog_cal_n; i++) {
+        if (i) s += ',';
+        s += String(c.analog_cal_raw[i]) + ":" + String(c.analog_cal_pct[i]);
+      }
+      return s;
+    }
+  }
+  return String();
+}
+
+void cfgFieldParse(const CfgField& f, Config& c, const String& v) {
+  switch (f.type) {
+    case CF_STR:  strlcpy((char*)at(c, f), v.c_str(), f.size); break;
+    case CF_UINT: {
+      // только цифры: strtoul("-1") заворачивается в 4294967295 и clamp давал max
+      char* end;
+      uint32_t n = (uint32_t) strtoul(v.c_str(), &end, 10);
+      if (isDigit(v[0]) && *end == '\0') setUint(f, c, n);
+      break;
+    }
+    case CF_BOOL: *(bool*)at(c, f) = v == "1"; break;
+    case CF_PIN:  { long p = v.toInt(); if (p >= 0 && p <= 16 && cfgPinValid(p)) *at(c, f) = (uint8_t)p; break; }
+    case CF_MODE: c.mode = v == "external" ? MODE_EXTERNAL : MODE_AUTO; break;
+    case CF_CAL: {
+      // "raw:pct,raw:pct,..." — неверная таблица игнорируется целиком
+      uint16_t raw[ANALOG_CAL_MAX]; uint8_t pct[ANALOG_CAL_MAX]; uint8_t n = 0;
+      bool bad = false;
+      int from = 0;
+      while (from < (int)v.length()) {
+        int comma = v.indexOf(',', from); if (comma < 0) comma = v.length();
+        String pt = v.substring(from, comma);
+        int colon = pt.indexOf(':');
+        if (colon <= 0 || colon + 1 >= (int)pt.length()) bad = true;
+        else if (n < ANALOG_CAL_MAX) { raw[n] = (uint16_t) pt.substring(0, colon).toInt(); pct[n] = (uint8_t) pt.substring(colon + 1).toInt(); }
+        if (n <= ANALOG_CAL_MAX) n++;   // лишние точки: n = MAX+1, calSet() отвергнет
+        from = comma + 1;
+      }
+      if (!bad) calSet(c, raw, pct, n);
+      break;
+    }
+  }
+}
+
+void cfgValidate(Config& c) {
+  if (c.pump_stop_pct <= c.pump_start_pct) c.pump_stop_pct = min(100, c.pump_start_pct + 1);
+  // MFLN знает только 512/1024/2048/4096, иначе полный 16 КБ фрагмент
+  if (c.mqtt_tls_rx > 4096) c.mqtt_tls_rx = 16384;
+  else { uint16_t rx = 512; while (rx < c.mqtt_tls_rx) rx <<= 1; c.mqtt_tls_rx = rx; }
+}
+
+static void fieldFromJson(const CfgField& f, Config& c, JsonVariantConst v) {
+  if (v.isNull()) return;
+  switch (f.type) {
+    case CF_STR:  if (v.is<const char*>()) strlcpy((char*)at(c, f), v.as<const char*>(), f.size); break;
+    case CF_UINT: if (v.is<uint32_t>()) setUint(f, c, v.as<uint32_t>()); break;
+    case CF_BOOL: if (v.is<bool>()) *(bool*)at(c, f) = v.as<bool>(); break;
+    case CF_PIN:  if (v.is<uint8_t>() && cfgPinValid(v.as<uint8_t>())) *at(c, f) = v.as<uint8_t>(); break;
+    case CF_MODE: c.mode = strcmp(v | "auto", "external") == 0 ? MODE_EXTERNAL : MODE_AUTO; break;
+    case CF_CAL: {
+      uint16_t raw[ANALOG_CAL_MAX]; uint8_t pct[ANALOG_CAL_MAX]; uint8_t n = 0;
+      bool bad = false;
+      for (JsonVariantConst pt : v.as<JsonArrayConst>()) {
+        if (!pt[0].is<uint16_t>() || !pt[1].is<uint8_t>()) bad = true;
+        else if (n < ANALOG_CAL_MAX) { raw[n] = pt[0]; pct[n] = pt[1]; }
+        if (n <= ANALOG_CAL_MAX) n++;
+      }
+      if (!bad) calSet(c, raw, pct, n);
+      break;
+    }
+  }
+}
+
+static void fieldToJson(const CfgField& f, const Config& c, JsonDocument& d) {
+  switch (f.type) {
+    case CF_STR:  d[FPSTR(f.key)] = (const char*)at(c, f); break;
+    case CF_UINT: d[FPSTR(f.key)] = getUint(f, c); break;
+    case CF_BOOL: d[FPSTR(f.key)] = *(const bool*)at(c, f); break;
+    case CF_PIN:  d[FPSTR(f.key)] = *at(c, f); break;
+    case CF_MODE: d[FPSTR(f.key)] = c.mode == MODE_EXTERNAL ? "external" : "auto"; break;
+    case CF_CAL: {
+      JsonArray cal = d.createNestedArray(FPSTR(f.key));
+      for (uint8_t i = 0; i < c.analog_cal_n; i++) {
+        JsonArray pt = cal.createNestedArray();
+        pt.add(c.analog_cal_raw[i]); pt.add(c.analog_cal_pct[i]);
+      }
+      break;
+    }
+  }
+}
+
+static bool readConfigFile() {
   LittleFS.begin();
   if (!LittleFS.exists(CFG_PATH)) return false;
   File f = LittleFS.open(CFG_PATH, "r");
@@ -15,63 +242,28 @@ bool loadConfig() {
   if (deserializeJson(d, f)) { f.close(); return false; }
   f.close();
 
-  // Базовые
-  strlcpy(cfg.device_name, d["device_name"] | cfg.device_name, sizeof(cfg.device_name));
-  strlcpy(cfg.base_topic,  d["base_topic"]  | cfg.base_topic,  sizeof(cfg.base_topic));
-  strlcpy(cfg.mqtt_host,   d["mqtt_host"]   | cfg.mqtt_host,   sizeof(cfg.mqtt_host));
-  cfg.mqtt_port = d["mqtt_port"] | cfg.mqtt_port;
-  strlcpy(cfg.mqtt_user, d["mqtt_user"] | cfg.mqtt_user, sizeof(cfg.mqtt_user));
-  strlcpy(cfg.mqtt_pass, d["mqtt_pass"] | cfg.mqtt_pass, sizeof(cfg.mqtt_pass));
-  strlcpy(cfg.web_user,  d["web_user"]  | cfg.web_user,  sizeof(cfg.web_user));
-  strlcpy(cfg.web_pass,  d["web_pass"]  | cfg.web_pass,  sizeof(cfg.web_pass));
-  cfg.sample_ms       = d["sample_ms"]       | cfg.sample_ms;
-  cfg.confirm_samples = d["confirm_samples"] | cfg.confirm_samples;
-
-  const char* mode_s  = d["mode"] | "auto";
-  cfg.mode = (strcmp(mode_s, "external") == 0) ? MODE_EXTERNAL : MODE_AUTO;
-
-  // Пины/логика (с дефолтами)
-  cfg.pin_sensor50   = d["pin_sensor50"]   | cfg.pin_sensor50;
-  cfg.pin_sensor100  = d["pin_sensor100"]  | cfg.pin_sensor100;
-  cfg.pin_factory    = d["pin_factory"]    | cfg.pin_factory;
-
-  cfg.s50_true_high    = d["s50_true_high"]    | cfg.s50_true_high;
-  cfg.s100_true_high   = d["s100_true_high"]   | cfg.s100_true_high;
-  cfg.factory_true_high= d["factory_true_high"]| cfg.factory_true_high;
-
-  cfg.s50_pullup      = d["s50_pullup"]      | cfg.s50_pullup;
-  cfg.s100_pullup     = d["s100_pullup"]     | cfg.s100_pullup;
-  cfg.factory_pullup  = d["factory_pullup"]  | cfg.factory_pullup;
-
+  for (uint8_t i = 0; i < CONFIG_FIELDS_N; i++) {
+    const CfgField f = cfgField(i);
+    fieldFromJson(f, cfg, d[FPSTR(f.key)]);
+  }
+  cfgValidate(cfg);
   return true;
 }
 
+bool loadConfig() {
+  bool ok = readConfigFile();
+#ifdef FIXED_HW
+  // пины датчиков зашиты в сборку — показываем в UI фактические значения,
+  // в том числе без файла конфигурации (первый старт, битый JSON)
+  cfg.pin_sensor50   = FIXED_PIN_S50;   cfg.s50_true_high  = FIXED_S50_HIGH;
+  cfg.pin_sensor100  = FIXED_PIN_S100;  cfg.s100_true_high = FIXED_S100_HIGH;
+#endif
+  return ok;
+}
+
 bool saveConfig() {
   DynamicJsonDocument d(4096);
-
-  d["device_name"]     = cfg.device_name;
-  d["base_topic"]      = cfg.base_topic;
-  d["mqtt_host"]       = cfg.mqtt_host;
-  d["mqtt_port"]       = cfg.mqtt_port;
-  d["mqtt_user"]       = cfg.mqtt_user;
-  d["mqtt_pass"]       = cfg.mqtt_pass;
-  d["web_user"]        = cfg.web_user;
-  d["web_pass"]        = cfg.web_pass;
-  d["sample_ms"]       = cfg.sample_ms;
-  d["confirm_samples"] = cfg.confirm_samples;
-  d["mode"]            = (cfg.mode == MODE_EXTERNAL) ? "external" : "auto";
-
-  d["pin_sensor50"]    = cfg.pin_sensor50;
-  d["pin_sensor100"]   = cfg.pin_sensor100;
-  d["pin_factory"]     = cfg.pin_factory;
-
-  d["s50_true_high"]     = cfg.s50_true_high;
-  d["s100_true_high"]    = cfg.s100_true_high;
-  d["factory_true_high"] = cfg.factory_true_high;
-
-  d["s50_pullup"]      = cfg.s50_pullup;
-  d["s100_pullup"]     = cfg.s100_pullup;
-  d["factory_pullup"]  = cfg.factory_pullup;
+  for (uint8_t i = 0; i < CONFIG_FIELDS_N; i++) fieldToJson(cfgField(i), cfg, d);
 
   File f = LittleFS.open(CFG_PATH, "w");
   if (!f) return false;
@@ -0,0 +1,79 @@
+#include "failsafe.h"
+#include "config.h"
+#include "relay.h"
+#include "sensors.h"
+#include "log.h"
+
+#include <core_esp8266_waveform.h>  // setTimer1Callback
+
+static const uint32_t POLL_US = 1000;  // период опроса из timer1
+
+static uint8_t  s_pin        = 0;
+static bool     s_true_high  = true;
+static uint32_t s_cyc_per_us = 80;
+
+static volatile bool     s_armed     = false;
+static volatile bool     s_latched   = false;
+static volatile uint16_t s_active_ms = 0;   // сколько опросов подряд датчик 100% активен
+static volatile uint32_t s_edge_cyc  = 0;   // 0 = фронт не отмечен
+static volatile uint32_t s_trips     = 0;
+static volatile uint32_t s_last_us   = 0;
+static volatile uint32_t s_worst_us  = 0;
+static uint32_t          s_seen_trips = 0;  // сколько отсечек уже залогировано
+static bool              s_forced     = false;
+
+static inline bool IRAM_ATTR fullActive() {
+  return (digitalRead(s_pin) == HIGH) == s_true_high;
+}
+
+void IRAM_ATTR failsafe_on_edge_isr() {
+  if (s_armed && !s_edge_cyc && fullActive()) s_edge_cyc = ESP.getCycleCount() | 1;
+}
+
+static uint32_t IRAM_ATTR onPoll() {
+  if (!s_armed || s_latched || !relay_get()) { s_active_ms = 0; return POLL_US; }
+  uint32_t now = ESP.getCycleCount();
+  if (!fullActive()) { s_active_ms = 0; s_edge_cyc = 0; return POLL_US; }
+  if (!s_edge_cyc) s_edge_cyc = now | 1;   // GPIO16 без прерываний — от первого опроса
+  if (++s_active_ms < cfg.failsafe_confirm_ms) return POLL_US;
+
+  relay_off_isr();
+  uint32_t us = (ESP.getCycleCount() - s_edge_cyc) / s_cyc_per_us;
+  s_last_us = us;
+  if (us > s_worst_us) s_worst_us = us;
+  s_trips++;
+  s_latched = true;
+  s_active_ms = 0;
+  s_edge_cyc = 0;
+  return POLL_US;
+}
+
+void failsafe_init(uint8_t pin100, bool true_high100) {
+  s_pin = pin100;
+  s_true_high = true_high100;
+  s_cyc_per_us = ESP.getCpuFreqMHz();
+}
+
+void failsafe_loop() {
+  // timer1-опрос только пока армировано (режим может смениться через MQTT / settings)
+  bool arm = (cfg.failsafe || s_forced) && cfg.mode == MODE_AUTO;
+  if (arm != s_armed) {
+    s_armed = arm;
+    setTimer1Callback(arm ? onPoll : nullptr);
+    LOGI("failsafe: %s", arm ? "armed" : "disarmed");
+  }
+
+  if (s_trips != s_seen_trips) {
+    s_seen_trips = s_trips;
+    LOGW("failsafe: relay cut from ISR, %u us after edge (worst %u us)", s_last_us, s_worst_us);
+  }
+  // Снимаем защёлку, когда антидребезг догнал (дальше держит обычная логика)
+  // или вход 100% вернулся в неактивное состояние (ложное срабатывание)
+  if (s_latched && (sensors_s100() || !fullActive())) s_latched = false;
+}
+
+void     failsafe_force(bool on) { s_forced = on; failsafe_loop(); }
+bool     failsafe_latched()  { return s_latched; }
+uint32_t failsafe_trips()    { return s_trips; }
+uint32_t failsafe_last_us()  { return s_last_us; }
+uint32_t failsafe_worst_us() { return s_worst_us; }
@@ -0,0 +1,70 @@
+#include "led.h"
+
+static const uint8_t LED_FRAME_MS = 10;   // 100 кадров/с
+
+// 0.5*(1-cos(2πt)), 10 шагов по 20 мс — 5 Гц
+static const uint8_t WAVE_PULSE[]  PROGMEM = { 0, 24, 88, 167, 231, 255, 231, 167, 88, 24 };
+static const uint8_t WAVE_ON[]     PROGMEM = { 255 };
+static const uint8_t WAVE_OFF[]    PROGMEM = { 0 };
+static const uint8_t WAVE_BLINK[]  PROGMEM = { 255, 0 };
+static const uint8_t WAVE_DOUBLE[] PROGMEM = { 255, 0, 255, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t WAVE_BLIP[]   PROGMEM = { 255, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                               0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+static const LedPattern PAT_OFF     = { WAVE_OFF,    1, 1000 };
+static const LedPattern PAT_LEVEL50 = { WAVE_BLINK,  2, 1000 };  // 1 c вкл / 1 c выкл
+static const LedPattern PAT_ON      = { WAVE_ON,     1, 1000 };
+static const LedPattern PAT_ERROR   = { WAVE_PULSE, 10, 20 };
+static const LedPattern PAT_WIFI    = { WAVE_DOUBLE, 10, 100 };  // двойная вспышка раз в 1 c
+static const LedPattern PAT_MQTT    = { WAVE_BLIP,  20, 100 };   // короткая вспышка раз в 2 c
+static const LedPattern PAT_OTA     = { WAVE_BLINK,  2, 50 };    // 10 Гц
+
+static const LedPattern* s_pat[LED_STATE_COUNT] = {
+  &PAT_OFF, &PAT_LEVEL50, &PAT_ON, &PAT_ERROR, &PAT_WIFI, &PAT_MQTT, &PAT_OTA
+};
+
+static uint8_t  s_pin      = 255;
+static bool     s_pwm      = true;
+static LedState s_state    = LED_OFF;
+static uint32_t s_next_ms  = 0;
+static int16_t  s_duty     = -1;     // последняя записанная скважность (0..1023)
+static uint32_t s_cyc_avg  = 0;
+
+void led_init(uint8_t pin) {
+  s_pin = pin;
+  s_pwm = (pin != 16);  // GPIO16 без PWM — только вкл/выкл по порогу
+  analogWriteRange(1023);
+  pinMode(s_pin, OUTPUT);
+  digitalWrite(s_pin, HIGH); // LED выкл (активен по LOW)
+  s_duty = 0;
+}
+
+void led_register(LedState st, const LedPattern* p) {
+  if (st < LED_STATE_COUNT && p && p->len) s_pat[st] = p;
+}
+
+void led_set_state(LedState st) {
+  if (st < LED_STATE_COUNT) s_state = st;
+}
+
+void led_tick(uint32_t now_ms) {
+  if ((int32_t)(now_ms - s_next_ms) < 0) return;
+  s_next_ms = now_ms + LED_FRAME_MS;
+  uint32_t c0 = ESP.getCycleCount();
+
+  const LedPattern* p = s_pat[s_state];
+  uint8_t  w    = pgm_read_byte(p->wave + (now_ms / p->step_ms) % p->len);
+  int16_t  duty = s_pwm ? (int16_t)((w << 2) | (w >> 6)) : (w >= 128 ? 1023 : 0);
+
+  if (duty != s_duty) {
+    s_duty = duty;
+    if (duty == 0)         digitalWrite(s_pin, HIGH);     // активен по LOW
+    else if (duty == 1023) digitalWrite(s_pin, LOW);
+    else                   analogWrite(s_pin, 1023 - duty);
+  }
+
+  uint32_t dc = ESP.getCycleCount() - c0;
+  s_cyc_avg = s_cyc_avg ? s_cyc_avg + ((int32_t)(dc - s_cyc_avg) >> 4) : dc;
+}
+
+uint32_t led_frame_cycles() { return s_cyc_avg; }
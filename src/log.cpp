@@ -0,0 +1,46 @@
+#include "log.h"
+
+struct LogEntry {
+  uint32_t    ms;
+  PGM_P       fmt;
+  uint32_t    args[LOG_MAX_ARGS];
+  uint8_t     level;
+};
+
+static LogEntry s_ring[LOG_RING_SIZE];
+static uint32_t s_head = 0;        // всего записей с момента старта
+static uint32_t s_serial_seq = 0;
+
+void log_push(uint8_t level, PGM_P fmt, const uint32_t* args, uint8_t n) {
+  LogEntry& e = s_ring[s_head % LOG_RING_SIZE];
+  e.ms = millis();
+  e.fmt = fmt;
+  e.level = level;
+  for (uint8_t i = 0; i < LOG_MAX_ARGS; i++) e.args[i] = i < n ? args[i] : 0;
+  s_head++;
+}
+
+uint32_t log_head() { return s_head; }
+uint32_t log_tail() { return s_head > LOG_RING_SIZE ? s_head - LOG_RING_SIZE : 0; }
+
+bool log_format(uint32_t seq, char* buf, size_t len) {
+  if (seq < log_tail() || seq >= s_head || !len) return false;
+  const LogEntry& e = s_ring[seq % LOG_RING_SIZE];
+  static const char LVL[] = "-EWID";
+  int n = snprintf(buf, len, "%lu.%03lu %c ", (unsigned long)(e.ms / 1000), (unsigned long)(e.ms % 1000),
+                   LVL[e.level < 5 ? e.level : 0]);
+  if (n < 0 || (size_t)n >= len) return true;
+  snprintf_P(buf + n, len - n, e.fmt, e.args[0], e.args[1], e.args[2], e.args[3]);
+  return true;
+}
+
+void log_loop() {
+#if LOG_SERIAL
+  if (s_serial_seq < log_tail()) s_serial_seq = log_tail();
+  // не больше пары строк за проход — Serial.write блокирует при полном FIFO
+  char line[128];
+  for (uint8_t i = 0; i < 2 && s_serial_seq < s_head; i++, s_serial_seq++) {
+    if (log_format(s_serial_seq, line, sizeof(line))) Serial.println(line);
+  }
+#endif
+}
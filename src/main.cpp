@@ -9,9 +9,25 @@
 #include "relay.h"
 #include "mqtt.h"
 #include "web.h"
+#include "power.h"
+#include "analog.h"
+#include "led.h"
+#include "log.h"
+#include "failsafe.h"
+#include "timesync.h"
+#include "rtcstate.h"
+#include "state.h"
+
+#ifdef FIXED_HW
+static const bool FIXED_HW_BUILD = true;
+#else
+static const bool FIXED_HW_BUILD = false;
+#endif
 
 // --- заводской сброс ---
 static void factoryReset() {
+  relay_set(false);
+  rtcstate_invalidate();
   for (int i=0;i<6;i++){ digitalWrite(LED_PIN, LOW); delay(150); digitalWrite(LED_PIN, HIGH); delay(150); }
   LittleFS.begin(); LittleFS.remove(CFG_PATH);
   WiFi.persistent(true); WiFi.disconnect(true); delay(200); WiFi.persistent(false);
@@ -23,11 +39,48 @@ void setup() {
   pinMode(LED_PIN, OUTPUT);
   digitalWrite(LED_PIN, HIGH);
 
-  Serial.begin(115200); delay(50);
+  Serial.begin(115200);
 
   LittleFS.begin();
   loadConfig(); // грузим ранним этапом (для кастомного factory pin)
 
+  // Тёплый старт (WDT/exception/soft reset): снимок управления из RTC
+  bool warm = rtcstate_begin();
+  const RtcSnapshot& snap = rtcstate_saved();
+  if (warm) cfg.mode = (ControlMode)snap.mode;
+
+  // Датчики
+  sensors_init(
+    cfg.pin_sensor50,  cfg.s50_true_high,  cfg.s50_pullup,
+    cfg.pin_sensor100, cfg.s100_true_high, cfg.s100_pullup,
+    cfg.sample_ms, cfg.sample_idle_ms, cfg.confirm_samples
+  );
+  led_init(LED_PIN);
+
+  analog_init();
+
+  // Реле: выкл; при тёплом старте в AUTO ниже возвращается как было до сброса
+  relay_init(PIN_RELAY);
+  relay_set(false);
+
+  // Отсечка перелива из прерывания — армируется в failsafe_loop() по режиму
+  failsafe_init(cfg.pin_sensor100, cfg.s100_true_high);
+  sensors_set_edge100_hook(failsafe_on_edge_isr);
+
+  if (warm) {
+    sensors_restore(snap.s50, snap.s100);
+    mqtt_seq_restore(snap.seq_state, snap.seq_attr);
+    // Насос возвращаем только в AUTO и только под отсечкой из ISR: loop() начнётся лишь после Wi-Fi.
+    // В EXTERNAL реле выкл, пока контроллер не подтвердит его по MQTT.
+    if (snap.relay && cfg.mode == MODE_AUTO) {
+      failsafe_force(true);
+      relay_set(true);
+    }
+  } else {
+    delay(50);
+  }
+  failsafe_loop();
+
   // Настраиваем пин сброса по конфигу
   pinMode(cfg.pin_factory, cfg.factory_pullup ? INPUT_PULLUP : INPUT);
   auto factoryActive = [&](){
@@ -47,17 +100,6 @@ void setup() {
     if (stillActive) factoryReset();
   }
 
-  // Датчики
-  sensors_init(
-    cfg.pin_sensor50,  cfg.s50_true_high,  cfg.s50_pullup,
-    cfg.pin_sensor100, cfg.s100_true_high, cfg.s100_pullup,
-    LED_PIN, cfg.sample_ms, cfg.confirm_samples
-  );
-
-  // Реле выкл по умолчанию
-  relay_init(PIN_RELAY);
-  relay_set(false);
-
   // Wi-Fi: если не подключилось — бесконечный AP-портал до конфигурации
   WiFiManager wm;
   char apName[32]; snprintf(apName, sizeof(apName), "Tank-%06X", ESP.getChipId() & 0xFFFFFF);
@@ -68,8 +110,18 @@ void setup() {
   // Веб + OTA
   web_init();
 
+  // Время (SNTP) — до MQTT, чтобы первые сообщения по возможности уже были с ts
+  timesync_init();
+
   // MQTT
   mqtt_init();
+  LOGI("boot: chip %06x, reset reason %u", ESP.getChipId() & 0xFFFFFF, ESP.getResetInfoPtr()->reason);
+
+  // Энергосбережение (если включено)
+  power_init();
+
+  failsafe_force(false);  // дальше отсечкой управляет cfg.failsafe
+  state_update();         // первый срез — до того, как web/MQTT начнут его читать
 }
 
 void loop() {
@@ -77,18 +129,43 @@ void loop() {
   web_loop();
   mqtt_loop();
 
-  // датчики и LED
+  // датчики: быстрый опрос, пока насос работает
+  sensors_set_active(relay_get());
   sensors_tick();
-  sensors_led_tick(millis());
+  analog_tick();
+  failsafe_loop();
 
   // авто-управление насосом
   if (cfg.mode == MODE_AUTO) {
-    bool want_on = !sensors_s100(); // нет 100% — насос включен
+    bool want_on;
+    if (analog_enabled()) {
+      // гистерезис по аналоговому уровню; поплавок 100% — всегда стоп
+      uint16_t pm = analog_permille();
+      want_on = relay_get() ? (pm < cfg.pump_stop_pct * 10) : (pm < cfg.pump_start_pct * 10);
+      if (sensors_s100()) want_on = false;
+    } else {
+      want_on = !sensors_s100(); // нет 100% — насос включен
+    }
+    if (failsafe_latched()) want_on = false; // ISR уже выключил — ждём антидребезг
     if (want_on != relay_get()) {
       relay_set(want_on);
     }
   }
 
+  // Единый срез: дальше LED, MQTT, лог и RTC читают только его
+  state_update();
+  const State& st = state();
+
+  // LED: приоритет OTA > ошибка > нет Wi-Fi > нет MQTT > уровень
+  LedState ls;
+  if (web_ota_active())                            ls = LED_OTA;
+  else if (st.error)                               ls = LED_ERROR;
+  else if (WiFi.status() != WL_CONNECTED)          ls = LED_WIFI_DOWN;
+  else if ((cfg.mqtt_host[0] || cfg.mqtt_fallback[0]) && !mqtt_online())     ls = LED_MQTT_DOWN;
+  else ls = st.level == 100 ? LED_LEVEL100 : (st.level == 50 ? LED_LEVEL50 : LED_OFF);
+  led_set_state(ls);
+  led_tick(millis());
+
   // Дифф-публикация статусов (раз в ~1 c достаточно)
   static uint32_t t_pub = 0;
   uint32_t now = millis();
@@ -97,12 +174,28 @@ void loop() {
     if (mqtt_online()) mqtt_publish_diff();
   }
 
-  // Отладочный лог — раз в секунду
+  // Лог: смена состояния — INFO; полный срез раз в секунду — только в DEBUG-сборке
+  uint8_t bits = st.s50 | st.s100 << 1 | st.relay << 2 | (st.mode == MODE_EXTERNAL) << 3;
+  static uint8_t last_bits = 0xFF;
+  if (bits != last_bits) {
+    last_bits = bits;
+    LOGI("state s50=%u s100=%u relay=%u mode=%s", (unsigned)st.s50, (unsigned)st.s100, (unsigned)st.relay,
+         state_mode_str(st.mode));
+  }
+#if LOG_LEVEL >= LOG_LVL_DEBUG
   static uint32_t t_log = 0;
   if ((int32_t)(now - t_log) >= 1000) {
     t_log = now;
-    Serial.printf("s50=%d s100=%d level=%d error=%d relay=%d mode=%s mqtt=%d\n",
-      (int)sensors_s50(), (int)sensors_s100(), sensors_level(), (int)sensors_error(),
-      (int)relay_get(), (cfg.mode==MODE_EXTERNAL) ? "EXTERNAL" : "AUTO", (int)mqtt_online());
+    LOGD("level=%d error=%u mqtt=%u led_cyc=%u", st.level, (unsigned)st.error,
+         (unsigned)mqtt_online(), led_frame_cycles());
+    LOGD("sample_cyc=%u fixed_hw=%u", sensors_sample_cycles(), (unsigned)FIXED_HW_BUILD);
   }
+#endif
+  log_loop();
+  rtcstate_loop();
+
+  // Low-power: спим до следующего отсчёта датчиков (фронт на входе будит раньше)
+  uint32_t next_due = sensors_next_sample_ms();
+  if (cfg.analog_enabled && (int32_t)(analog_next_sample_ms() - next_due) < 0) next_due = analog_next_sample_ms();
+  power_idle(next_due);
 }
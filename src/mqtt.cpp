@@ -3,14 +3,58 @@
 #include "hardware.h"
 #include "sensors.h"
 #include "relay.h"
+#include "power.h"
+#include "analog.h"
+#include "log.h"
+#include "failsafe.h"
+#include "timesync.h"
+#include "rtcstate.h"
+#include "state.h"
 
 #include <ESP8266WiFi.h>
+#include <WiFiClientSecure.h>
+#include <LittleFS.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
 
 static WiFiClient   s_client;
+static BearSSL::WiFiClientSecure s_tls;
+static BearSSL::X509List* s_ca = nullptr;
 static PubSubClient s_mqtt(s_client);
 static bool         s_online = false;
+static MqttStats    s_stats;
+static bool         s_in_discovery = false;
+static uint32_t     s_lost_ms = 0;       // момент потери связи (0 = не терялась)
+
+// Брокеры: [0] = mqtt_host:mqtt_port, дальше mqtt_fallback в порядке приоритета
+static const uint8_t MQTT_BROKERS_MAX = 4;
+struct Broker {
+  char     host[64]   = "";
+  uint16_t port       = 0;
+  uint8_t  fails      = 0;   // неудач подряд
+  uint32_t retry_at   = 0;   // backoff: не пытаться раньше (при fails > 0)
+  uint32_t connect_ms = 0;   // EWMA 1/4: TCP(+TLS) + CONNECT; 0 = не мерили
+  uint32_t rtt_ms     = 0;   // EWMA 1/8 петлевого пинга
+  uint16_t tls_rx     = 0;   // rx-буфер TLS после проверки MFLN (0 = не проверяли)
+  BearSSL::Session session;  // кэш TLS-сессии этого брокера
+};
+static Broker   s_brokers[MQTT_BROKERS_MAX];
+static uint8_t  s_nbrokers = 0;
+static int8_t   s_cur = -1;          // брокер текущей/последней попытки
+static int8_t   s_last_ok = -1;      // брокер последней успешной сессии
+static uint32_t s_hold_ms = 0;       // отсчёт hold-down до проверки failback
+
+// Все публикации идут через pub(): счётчики пакетов/байт на проводе
+static bool pub(const char* topic, const char* payload, bool retain) {
+  size_t rem   = 2 + strlen(topic) + strlen(payload);       // QoS0: topic + payload
+  size_t bytes = 1 + (rem < 128 ? 1 : rem < 16384 ? 2 : 3) + rem;
+  bool ok = s_mqtt.publish(topic, payload, retain);
+  if (!ok) { s_stats.publish_fails++; return false; }
+  s_stats.publishes++;
+  s_stats.publish_bytes += bytes;
+  if (s_in_discovery) { s_stats.discovery_packets++; s_stats.discovery_bytes += bytes; }
+  return true;
+}
 
 // ----------------- helpers -----------------
 static String macStr() {
@@ -30,7 +74,18 @@ static String topicRelaySet()      { return topicBase() + "/relay/set"; }
 static String topicModeState()     { return topicBase() + "/mode/state"; }
 static String topicModeSet()       { return topicBase() + "/mode/set"; }
 static String topicAttr()          { return topicBase() + "/attributes"; }
+static String topicState()         { return topicBase() + "/state"; }   // JSON-срез с seq/ts
 static String topicIp()            { return topicBase() + "/ip"; }
+static String topicPing()          { return topicBase() + "/ping"; }   // петля для замера RTT
+static String topicRtt()           { return topicBase() + "/rtt"; }
+static String topicBroker()        { return topicBase() + "/broker"; }  // host:port текущего брокера
+static String topicAck()           { return topicBase() + "/ack"; }
+// групповые (общие для площадки) команды: <group_topic>/relay/set, <group_topic>/mode/set
+static String topicGroupRelaySet() { return String(cfg.group_topic) + "/relay/set"; }
+static String topicGroupModeSet()  { return String(cfg.group_topic) + "/mode/set"; }
+static String topicDebug()         { return topicBase() + "/debug"; }
+static String topicAnalogState()   { return topicBase() + "/analog/state"; }
+static String topicVolumeState()   { return topicBase() + "/volume/state"; }
 
 // discovery
 static String discTopicLevel()     { return "homeassistant/sensor/"        + String(cfg.device_name) + "/level/config"; }
@@ -38,6 +93,10 @@ static String discTopicError()     { return "homeassistant/binary_sensor/" + Str
 static String discTopicRelay()     { return "homeassistant/switch/"        + String(cfg.device_name) + "/pump/config"; }
 static String discTopicMode()      { return "homeassistant/select/"        + String(cfg.device_name) + "/mode/config"; }
 static String discTopicIP()        { return "homeassistant/sensor/"        + String(cfg.device_name) + "/ip/config"; }
+static String discTopicBroker()    { return "homeassistant/sensor/"        + String(cfg.device_name) + "/broker/config"; }
+static String discTopicRtt()       { return "homeassistant/sensor/"        + String(cfg.device_name) + "/rtt/config"; }
+static String discTopicAnalog()    { return "homeassistant/sensor/"        + String(cfg.device_name) + "/analog/config"; }
+static String discTopicVolume()    { return "homeassistant/sensor/"        + String(cfg.device_name) + "/volume/config"; }
 
 static void addDeviceObject(JsonObject dev) {
   dev["ids"]  = String(cfg.device_name);
@@ -51,6 +110,8 @@ static void addDeviceObject(JsonObject dev) {
 }
 
 static void sendDiscovery() {
+  s_in_discovery = true;
+  s_stats.discovery_packets = s_stats.discovery_bytes = 0;
   // level
   {
     DynamicJsonDocument d(1024);
@@ -63,7 +124,7 @@ static void sendDiscovery() {
     d["state_class"]  = "measurement";
     addDeviceObject(d.createNestedObject("dev"));
     String payload; serializeJson(d, payload);
-    s_mqtt.publish(discTopicLevel().c_str(), payload.c_str(), true);
+    pub(discTopicLevel().c_str(), payload.c_str(), true);
   }
   // error
   {
@@ -78,7 +139,7 @@ static void sendDiscovery() {
     d["icon"]    = "mdi:alert-circle";
     addDeviceObject(d.createNestedObject("dev"));
     String payload; serializeJson(d, payload);
-    s_mqtt.publish(discTopicError().c_str(), payload.c_str(), true);
+    pub(discTopicError().c_str(), payload.c_str(), true);
   }
   // relay
   {
@@ -95,7 +156,7 @@ static void sendDiscovery() {
     d["icon"]     = "mdi:pump";
     addDeviceObject(d.createNestedObject("dev"));
     String payload; serializeJson(d, payload);
-    s_mqtt.publish(discTopicRelay().c_str(), payload.c_str(), true);
+    pub(discTopicRelay().c_str(), payload.c_str(), true);
   }
   // mode
   {
@@ -110,7 +171,7 @@ static void sendDiscovery() {
     d["icon"]    = "mdi:automation";
     addDeviceObject(d.createNestedObject("dev"));
     String payload; serializeJson(d, payload);
-    s_mqtt.publish(discTopicMode().c_str(), payload.c_str(), true);
+    pub(discTopicMode().c_str(), payload.c_str(), true);
   }
   // ip
   {
@@ -123,110 +184,211 @@ static void sendDiscovery() {
     d["ent_cat"] = "diagnostic";
     addDeviceObject(d.createNestedObject("dev"));
     String payload; serializeJson(d, payload);
-    s_mqtt.publish(discTopicIP().c_str(), payload.c_str(), true);
+    pub(discTopicIP().c_str(), payload.c_str(), true);
+  }
+  // broker
+  {
+    DynamicJsonDocument d(1024);
+    d["name"]    = String(cfg.device_name) + " MQTT broker";
+    d["uniq_id"] = String(cfg.device_name) + "-broker";
+    d["stat_t"]  = topicBroker();
+    d["avty_t"]  = topicAvail();
+    d["icon"]    = "mdi:server-network";
+    d["ent_cat"] = "diagnostic";
+    addDeviceObject(d.createNestedObject("dev"));
+    String payload; serializeJson(d, payload);
+    pub(discTopicBroker().c_str(), payload.c_str(), true);
+  }
+  // rtt
+  if (cfg.mqtt_ping_s) {
+    DynamicJsonDocument d(1024);
+    d["name"]         = String(cfg.device_name) + " MQTT RTT";
+    d["uniq_id"]      = String(cfg.device_name) + "-rtt";
+    d["stat_t"]       = topicRtt();
+    d["avty_t"]       = topicAvail();
+    d["unit_of_meas"] = "ms";
+    d["icon"]         = "mdi:timer-sync";
+    d["state_class"]  = "measurement";
+    d["ent_cat"]      = "diagnostic";
+    addDeviceObject(d.createNestedObject("dev"));
+    String payload; serializeJson(d, payload);
+    pub(discTopicRtt().c_str(), payload.c_str(), true);
   }
+  if (!cfg.analog_enabled) { s_in_discovery = false; return; }
+  // analog level
+  {
+    DynamicJsonDocument d(1024);
+    d["name"]         = String(cfg.device_name) + " Analog level";
+    d["uniq_id"]      = String(cfg.device_name) + "-analog";
+    d["stat_t"]       = topicAnalogState();
+    d["avty_t"]       = topicAvail();
+    d["unit_of_meas"] = "%";
+    d["icon"]         = "mdi:gauge";
+    d["state_class"]  = "measurement";
+    addDeviceObject(d.createNestedObject("dev"));
+    String payload; serializeJson(d, payload);
+    pub(discTopicAnalog().c_str(), payload.c_str(), true);
+  }
+  // volume
+  if (cfg.tank_litres) {
+    DynamicJsonDocument d(1024);
+    d["name"]         = String(cfg.device_name) + " Volume";
+    d["uniq_id"]      = String(cfg.device_name) + "-volume";
+    d["stat_t"]       = topicVolumeState();
+    d["avty_t"]       = topicAvail();
+    d["unit_of_meas"] = "L";
+    d["dev_cla"]      = "volume_storage";
+    d["state_class"]  = "measurement";
+    addDeviceObject(d.createNestedObject("dev"));
+    String payload; serializeJson(d, payload);
+    pub(discTopicVolume().c_str(), payload.c_str(), true);
+  }
+  s_in_discovery = false;
 }
 
 // retained publications
-static void publishAvailability() { s_mqtt.publish(topicAvail().c_str(), "online", true); }
-static void publishMode()         { s_mqtt.publish(topicModeState().c_str(), (cfg.mode==MODE_EXTERNAL) ? "external" : "auto", true); }
-static void publishLevel(int v)   { String s = String(v); s_mqtt.publish(topicLevelState().c_str(), s.c_str(), true); }
-static void publishError(bool e)  { s_mqtt.publish(topicErrorState().c_str(), e ? "ON" : "OFF", true); }
-static void publishRelay(bool on) { s_mqtt.publish(topicRelayState().c_str(), on ? "ON" : "OFF", true); }
-static void publishIp()           { String ip = WiFi.localIP().toString(); s_mqtt.publish(topicIp().c_str(), ip.c_str(), true); }
+static void publishAvailability() { pub(topicAvail().c_str(), "online", true); }
+static void publishUnavailable()  { pub(topicAvail().c_str(), "offline", true); }
+static void publishMode()         { pub(topicModeState().c_str(), state_mode_str(state().mode), true); }
+static void publishLevel(int v)   { String s = String(v); pub(topicLevelState().c_str(), s.c_str(), true); }
+static void publishError(bool e)  { pub(topicErrorState().c_str(), e ? "ON" : "OFF", true); }
+static void publishRelay(bool on) { pub(topicRelayState().c_str(), on ? "ON" : "OFF", true); }
+static void publishIp()           { String ip = WiFi.localIP().toString(); pub(topicIp().c_str(), ip.c_str(), true); }
+static void publishBroker()       { String b = mqtt_broker(); pub(topicBroker().c_str(), b.c_str(), true); }
+static void publishAnalog(const State& st) {
+  char b[8]; snprintf(b, sizeof(b), "%u.%u", st.analog_pm / 10, st.analog_pm % 10);
+  pub(topicAnalogState().c_str(), b, true);
+  if (cfg.tank_litres) {
+    String l = String(st.litres);
+    pub(topicVolumeState().c_str(), l.c_str(), true);
+  }
+}
+// ,"seq":N,"ts":<epoch ms>,"up":<millis>} — монотонный номер сообщения топика и метки времени устройства
+static uint32_t s_seq_state = 0;   // <base>/state
+static uint32_t s_seq_attr  = 0;   // <base>/attributes
+static String stampTail(uint32_t& seq) {
+  char ts[24]; timesync_format_ms(ts, sizeof(ts));
+  char b[80];
+  snprintf(b, sizeof(b), ",\"seq\":%u,\"ts\":%s,\"up\":%u}", ++seq, ts, (unsigned)millis());
+  return String(b);
+}
+uint32_t mqtt_seq_state() { return s_seq_state; }
+uint32_t mqtt_seq_attr()  { return s_seq_attr; }
+void     mqtt_seq_restore(uint32_t state_seq, uint32_t attr_seq) { s_seq_state = state_seq; s_seq_attr = attr_seq; }
+
+static String stamped(const String& json, uint32_t& seq) {
+  String p = json.substring(0, json.length() - 1);
+  p += stampTail(seq);
+  return p;
+}
+
 static void publishAttr_payload(const String& payload) {
-  s_mqtt.publish(topicAttr().c_str(), payload.c_str(), true);
+  // seq/ts дописываем только при отправке: в сравнении для диффа их нет
+  String p = stamped(payload, s_seq_attr);
+  pub(topicAttr().c_str(), p.c_str(), true);
+}
+
+static void publishState() {
+  String p = stamped(state_json(), s_seq_state);   // JSON собран один раз на версию среза
+  pub(topicState().c_str(), p.c_str(), true);
 }
 
 // атрибуты: формируем payload БЕЗ uptime, чтобы дифф не триггерился каждую секунду
 static String buildAttrPayload() {
-  StaticJsonDocument<256> attr;
+  const State& st = state();
+  StaticJsonDocument<896> attr;
   attr["sample_ms"]      = cfg.sample_ms;
   attr["confirm_needed"] = cfg.confirm_samples;
-  attr["mode"]           = (cfg.mode==MODE_EXTERNAL) ? "external" : "auto";
-  attr["rssi"]           = WiFi.RSSI();
-  attr["s50"]            = sensors_s50();
-  attr["s100"]           = sensors_s100();
-  attr["error"]          = sensors_error();
+  attr["sample_hz"]      = sensors_rate_x10() / 10.0f;
+  attr["confirm_ms_run"] = sensors_confirm_ms(true);
+  attr["confirm_ms_idle"]= sensors_confirm_ms(false);
+  attr["mode"]           = state_mode_str(st.mode);
+  attr["rssi"]           = st.rssi;
+  attr["s50"]            = st.s50;
+  attr["s100"]           = st.s100;
+  attr["error"]          = st.error;
+  if (cfg.failsafe) {
+    attr["failsafe_trips"]    = failsafe_trips();
+    attr["failsafe_worst_us"] = failsafe_worst_us();
+  }
+  attr["reset_reason"]   = ESP.getResetReason();
+  attr["warm_boots"]     = rtcstate_warm_boots();
+  attr["cold_boots"]     = rtcstate_cold_boots();
+  if (s_stats.rtt_last_ms) {
+    attr["rtt_ms"]       = s_stats.rtt_avg_ms;
+    attr["rtt_max_ms"]   = s_stats.rtt_max_ms;
+  }
+  if (s_nbrokers > 1) {
+    attr["broker"]         = s_stats.broker;
+    attr["failovers"]      = s_stats.failovers;
+    attr["failover_ms"]    = s_stats.failover_ms;
+  }
+  if (cfg.mqtt_tls) {
+    attr["tls_full_ms"]    = s_stats.tls_full_ms;
+    attr["tls_resumed_ms"] = s_stats.tls_resumed_ms;
+  }
+  if (timesync_synced()) {
+    attr["ntp_syncs"]     = timesync_syncs();
+    attr["ntp_offset_ms"] = timesync_offset_ms();
+    attr["ntp_drift_ppm"] = timesync_drift_ppm();
+  }
+  if (power_active()) {
+    attr["awake_pct"]    = power_awake_pct();
+    attr["est_ma"]       = power_est_ua() / 1000.0f;
+  }
   String payload; serializeJson(attr, payload);
   return payload;
 }
 
-// cache для дифф-публикации
-static bool   cache_init = false;
-static int    last_level = -1;
-static bool   last_error = false;
-static bool   last_relay = false;
-static String last_mode;
+// Дифф-публикация: сравниваем срез с последним отправленным
+static State  s_sent;
 static String last_ip;
 static String last_attr;
 static uint32_t last_attr_pub_ms = 0;
 
-static void ensure_cache_init() {
-  if (cache_init) return;
-  last_level = sensors_level();
-  last_error = sensors_error();
-  last_relay = relay_get();
-  last_mode  = (cfg.mode==MODE_EXTERNAL) ? "external" : "auto";
-  last_ip    = WiFi.localIP().toString();
-  last_attr  = buildAttrPayload();
+static void publishAttrNow() {
+  last_attr = buildAttrPayload();
+  publishAttr_payload(last_attr);
   last_attr_pub_ms = millis();
-  cache_init = true;
 }
 
 // ----------------- API -----------------
 void mqtt_publish_all() {
   if (!s_online) return;
+  const State& st = state();
   publishAvailability();
   sendDiscovery();
   publishMode();
   publishIp();
-  publishLevel(sensors_level());
-  publishError(sensors_error());
-  publishRelay(relay_get());
-  // атрибуты единоразово
-  String p = buildAttrPayload();
-  publishAttr_payload(p);
-  last_attr = p;
-  last_attr_pub_ms = millis();
+  publishBroker();
+  publishLevel(st.level);
+  publishError(st.error);
+  publishRelay(st.relay);
+  if (st.analog) publishAnalog(st);
+  publishState();
+  publishAttrNow();
+  s_sent  = st;
+  last_ip = WiFi.localIP().toString();
 }
 
 void mqtt_publish_diff() {
   if (!s_online) return;
-  ensure_cache_init();
-
+  const State& st = state();
+  uint32_t now = millis();
   bool changed = false;
 
-  // level
-  int lvl = sensors_level();
-  if (lvl != last_level) {
-    publishLevel(lvl);
-    last_level = lvl;
-    changed = true;
-  }
-
-  // error
-  bool err = sensors_error();
-  if (err != last_error) {
-    publishError(err);
-    last_error = err;
-    changed = true;
-  }
-
-  // relay
-  bool rel = relay_get();
-  if (rel != last_relay) {
-    publishRelay(rel);
-    last_relay = rel;
-    changed = true;
-  }
-
-  // mode — может измениться через /settings или MQTT командой
-  String mode = (cfg.mode==MODE_EXTERNAL) ? "external" : "auto";
-  if (mode != last_mode) {
-    publishMode();
-    last_mode = mode;
-    changed = true;
+  if (st.version != s_sent.version) {
+    if (st.level != s_sent.level) { publishLevel(st.level); changed = true; }
+    if (st.error != s_sent.error) { publishError(st.error); changed = true; }
+    if (st.relay != s_sent.relay) { publishRelay(st.relay); changed = true; }
+    // mode — может измениться через /settings или MQTT командой
+    if (st.mode  != s_sent.mode)  { publishMode();          changed = true; }
+    changed |= st.s50 != s_sent.s50 || st.s100 != s_sent.s100;
+    // analog — deadband уже учтён в срезе
+    bool analog_changed = st.analog && (!s_sent.analog || st.analog_pm != s_sent.analog_pm);
+    if (analog_changed) publishAnalog(st);
+    if (changed || analog_changed) publishState();
+    s_sent = st;
   }
 
   // ip — публикуем только при смене
@@ -238,7 +400,6 @@ void mqtt_publish_diff() {
 
   // attributes — при значимых изменениях сразу, иначе heartbeat раз в 5 минут
   const uint32_t ATTR_HEARTBEAT_MS = 300000; // 5 минут
-  uint32_t now = millis();
 
   if (changed) {
     String p = buildAttrPayload();
@@ -248,95 +409,358 @@ void mqtt_publish_diff() {
       last_attr_pub_ms = now;
     }
   } else if ((int32_t)(now - last_attr_pub_ms) >= (int32_t)ATTR_HEARTBEAT_MS) {
-    String p = buildAttrPayload();
-    if (p != last_attr) {
-      publishAttr_payload(p);
-      last_attr = p;
-    } else {
-      // даже если не изменилось — дернем по таймеру, чтобы у клиентов был “живой” retained с новым timestamp брокера
-      publishAttr_payload(p);
-    }
-    last_attr_pub_ms = now;
+    // даже если не изменилось — дернем по таймеру, чтобы у клиентов был “живой” retained с новым timestamp брокера
+    publishAttrNow();
   }
 }
 
+// Подтверждение команды в <base>/ack: оркестратор сверяет seq по всей группе
+static void publishAck(long seq, const char* cmd, const String& val, bool group) {
+  StaticJsonDocument<192> d;
+  d["dev"]   = cfg.device_name;
+  d["seq"]   = seq;
+  d["cmd"]   = cmd;
+  d["val"]   = val;
+  d["group"] = group;
+  d["up_ms"] = millis();
+  String p; serializeJson(d, p);
+  pub(topicAck().c_str(), p.c_str(), false);
+}
+
+// RTT: публикуем millis() в <base>/ping и ждём его же обратно через брокер
+static uint32_t s_ping_sent_ms = 0;   // 0 = ответа не ждём
+
+static void onPingEcho(const String& msg) {
+  uint32_t sent = (uint32_t)strtoul(msg.c_str(), nullptr, 10);
+  if (!s_ping_sent_ms || sent != s_ping_sent_ms) return;   // чужое/старое эхо
+  uint32_t rtt = millis() - sent;
+  s_ping_sent_ms = 0;
+  s_stats.rtt_last_ms = rtt;
+  if (s_cur >= 0) { Broker& b = s_brokers[s_cur]; b.rtt_ms = b.rtt_ms ? (b.rtt_ms * 7 + rtt) / 8 : rtt; }
+  s_stats.rtt_avg_ms  = s_stats.rtt_avg_ms ? (s_stats.rtt_avg_ms * 7 + rtt) / 8 : rtt;
+  if (rtt > s_stats.rtt_max_ms) s_stats.rtt_max_ms = rtt;
+  String v = String(s_stats.rtt_avg_ms);   // сглаженное — без скачков на графике
+  pub(topicRtt().c_str(), v.c_str(), true);
+}
+
+static void pingTick() {
+  if (!cfg.mqtt_ping_s) return;
+  static uint32_t t_ping = 0;
+  uint32_t now = millis();
+  if (t_ping && (uint32_t)(now - t_ping) < cfg.mqtt_ping_s * 1000UL) return;
+  if (s_ping_sent_ms) s_stats.pings_lost++;   // прошлый пинг так и не вернулся
+  t_ping = now;
+  s_ping_sent_ms = now | 1;
+  String v = String(s_ping_sent_ms);
+  pub(topicPing().c_str(), v.c_str(), false);
+}
+
 static void onMessage(char* topic, byte* payload, unsigned int length) {
   String t(topic);
   String msg; msg.reserve(length+1);
   for (unsigned int i=0;i<length;i++) msg += (char)payload[i];
-  msg.trim(); msg.toLowerCase();
+  msg.trim();
+
+  if (t == topicPing()) { onPingEcho(msg); return; }
+
+  // Команда может прийти как {"seq":N,"val":"..."} — тогда подтверждаем её номер
+  long seq = -1;
+  if (msg.startsWith("{")) {
+    StaticJsonDocument<128> d;
+    if (!deserializeJson(d, msg)) { seq = d["seq"] | -1L; msg = (const char*)(d["val"] | ""); }
+  }
+  msg.toLowerCase();
 
-  if (t == topicRelaySet()) {
+  bool group    = cfg.group_topic[0] != '\0';
+  bool relayCmd = (t == topicRelaySet()) || (group && t == topicGroupRelaySet());
+  bool modeCmd  = (t == topicModeSet())  || (group && t == topicGroupModeSet());
+  group = group && (t == topicGroupRelaySet() || t == topicGroupModeSet());
+
+  if (relayCmd) {
     bool want_on = (msg=="on" || msg=="1" || msg=="true");
     relay_set(want_on);
-    publishRelay(want_on);
-    // обновим атрибуты
-    String p = buildAttrPayload();
-    publishAttr_payload(p);
-    last_attr = p;
-    last_attr_pub_ms = millis();
-  } else if (t == topicModeSet()) {
-    if (msg=="external") cfg.mode = MODE_EXTERNAL;
-    else                 cfg.mode = MODE_AUTO;
-    saveConfig();
-    publishMode();
-    // и атрибуты
-    String p = buildAttrPayload();
-    publishAttr_payload(p);
-    last_attr = p;
-    last_attr_pub_ms = millis();
+    state_update();        // ответ тем же путём, что и в loop(): срез -> дифф
+    mqtt_publish_diff();
+    if (group || seq >= 0) publishAck(seq, "relay", want_on ? "on" : "off", group);
+  } else if (modeCmd) {
+    ControlMode m = (msg=="external") ? MODE_EXTERNAL : MODE_AUTO;
+    if (m != cfg.mode) { cfg.mode = m; saveConfig(); }   // групповая команда не пишет флеш зря
+    state_update();
+    mqtt_publish_diff();
+    if (group || seq >= 0) publishAck(seq, "mode", m == MODE_EXTERNAL ? "external" : "auto", group);
+  }
+}
+
+// TLS: доверие — CA из файла (нужно время SNTP для проверки сроков) или SHA1-отпечаток.
+// Без действующего пина не подключаемся вовсе: до insecure не понижаем.
+static bool s_tls_pinned = false;
+
+static void tlsInit() {
+  s_tls.setTimeout(cfg.mqtt_timeout_s * 1000UL);
+  File f = LittleFS.open(MQTT_CA_PATH, "r");
+  if (f) {
+    String pem = f.readString(); f.close();
+    s_ca = new BearSSL::X509List(pem.c_str());
+    if (s_ca->getCount()) {
+      s_tls.setTrustAnchors(s_ca);
+      LOGI("mqtt: tls, CA pinned (%u certs)", s_ca->getCount());
+      s_tls_pinned = true;
+      return;
+    }
+    delete s_ca; s_ca = nullptr;
+    LOGE("mqtt: tls, no valid certs in %s", MQTT_CA_PATH);
+    return;
+  }
+  if (cfg.mqtt_fp[0]) {
+    s_tls_pinned = s_tls.setFingerprint(cfg.mqtt_fp);
+    if (s_tls_pinned) LOGI("mqtt: tls, fingerprint pinned");
+    else              LOGE("mqtt: tls, bad fingerprint");
+    return;
+  }
+  LOGE("mqtt: tls needs a CA (%s) or a fingerprint, not connecting", MQTT_CA_PATH);
+}
+
+// TCP + TLS отдельно от CONNECT: PubSubClient увидит открытый сокет.
+// Возобновление определяем по сессии: предложили и брокер её не заменил.
+// MFLN: «да» от пробы — это ServerHello с расширением, кэшируем сразу. «Нет» выдаёт и
+// недоступный брокер — 16 КБ берём только на эту попытку, в кэш лишь после рукопожатия.
+static bool tlsConnect(Broker& b) {
+  uint16_t rx = b.tls_rx;
+  bool no_mfln = false;
+  if (!rx) {
+    rx = cfg.mqtt_tls_rx;
+    if (rx < 16384 && !BearSSL::WiFiClientSecure::probeMaxFragmentLength(b.host, b.port, rx)) {
+      rx = 16384;
+      no_mfln = true;
+    } else {
+      b.tls_rx = rx;
+    }
+  }
+  s_stats.tls_mfln = rx < 16384;
+  s_tls.setBufferSizes(rx, cfg.mqtt_tls_tx);
+  s_tls.setSession(&b.session);
+
+  static const BearSSL::Session none;
+  BearSSL::Session before;
+  memcpy(&before, &b.session, sizeof(before));
+  bool offered = memcmp(&before, &none, sizeof(before)) != 0;
+
+  uint32_t t0 = millis();
+  if (!s_tls.connect(b.host, b.port)) {
+    LOGW("mqtt: tls handshake with %s:%u failed, ssl error %d", b.host, b.port, s_tls.getLastSSLError());
+    return false;
   }
+  uint32_t ms = millis() - t0;
+  if (no_mfln) {
+    b.tls_rx = 16384;
+    LOGW("mqtt: %s has no MFLN, tls rx buffer %u -> 16384", b.host, cfg.mqtt_tls_rx);
+  }
+  if (offered && memcmp(&before, &b.session, sizeof(before)) == 0) {
+    s_stats.tls_resumed++; s_stats.tls_resumed_ms = ms;
+    LOGI("mqtt: tls resumed in %u ms", ms);
+  } else {
+    s_stats.tls_full++; s_stats.tls_full_ms = ms;
+    LOGI("mqtt: tls full handshake in %u ms", ms);
+  }
+  return true;
+}
+
+static void addBroker(const char* host, size_t n, uint16_t port) {
+  while (n && *host == ' ') { host++; n--; }
+  while (n && host[n - 1] == ' ') n--;
+  if (!n || n >= sizeof(Broker::host) || s_nbrokers >= MQTT_BROKERS_MAX) return;
+  Broker& b = s_brokers[s_nbrokers++];
+  memcpy(b.host, host, n); b.host[n] = '\0';
+  b.port = port;
+}
+
+// "host[:port],host[:port]" — без порта берётся mqtt_port
+static void parseBrokers() {
+  s_nbrokers = 0;
+  if (cfg.mqtt_host[0]) addBroker(cfg.mqtt_host, strlen(cfg.mqtt_host), cfg.mqtt_port);
+  const char* p = cfg.mqtt_fallback;
+  while (*p) {
+    const char* end = strchr(p, ',');
+    if (!end) end = p + strlen(p);
+    const char* colon = (const char*) memchr(p, ':', end - p);
+    uint16_t port = colon ? (uint16_t) atoi(colon + 1) : 0;
+    addBroker(p, (colon ? colon : end) - p, port ? port : cfg.mqtt_port);
+    p = *end ? end + 1 : end;
+  }
+}
+
+static bool brokerDue(const Broker& b, uint32_t now) {
+  return !b.fails || (int32_t)(now - b.retry_at) >= 0;
+}
+
+static void brokerFailed(Broker& b) {
+  if (b.fails < 255) b.fails++;
+  uint32_t backoff = 3000UL << min<uint8_t>(b.fails - 1, 4);   // 3, 6, 12, 24, 30 c
+  b.retry_at = millis() + min<uint32_t>(backoff, 30000UL);
+}
+
+// j лучше i: заметно (на 25%) быстрее, либо выше в списке и не заметно медленнее.
+// Не мерянный брокер сравним с любым — решает порядок списка.
+static bool brokerPrefer(uint8_t j, uint8_t i) {
+  uint32_t sj = s_brokers[j].connect_ms + s_brokers[j].rtt_ms;
+  uint32_t si = s_brokers[i].connect_ms + s_brokers[i].rtt_ms;
+  if (!s_brokers[j].connect_ms || !s_brokers[i].connect_ms) return j < i;
+  if (sj * 5 / 4 < si) return true;
+  if (si * 5 / 4 < sj) return false;
+  return j < i;
+}
+
+static int8_t brokerPick(uint32_t now) {
+  int8_t best = -1;
+  for (uint8_t i = 0; i < s_nbrokers; i++) {
+    if (brokerDue(s_brokers[i], now) && (best < 0 || brokerPrefer(i, best))) best = i;
+  }
+  return best;
+}
+
+// Раз в hold-down: если есть брокер лучше текущего и он отвечает по TCP — уходим к нему.
+// Проба до разрыва, чтобы не бросать рабочую сессию ради лежащего брокера.
+static void failbackTick() {
+  if (s_nbrokers < 2 || !cfg.mqtt_failback_s) return;
+  uint32_t now = millis();
+  if (now - s_hold_ms < cfg.mqtt_failback_s * 1000UL) return;
+  s_hold_ms = now;
+  int8_t best = brokerPick(now);
+  if (best < 0 || best == s_cur) return;
+  Broker& b = s_brokers[best];
+  WiFiClient probe;
+  probe.setTimeout(cfg.mqtt_timeout_s * 1000UL);
+  if (!probe.connect(b.host, b.port)) { brokerFailed(b); return; }
+  probe.stop();
+  LOGI("mqtt: failback %s:%u -> %s:%u", s_brokers[s_cur].host, s_brokers[s_cur].port, b.host, b.port);
+  // чистый DISCONNECT не вызывает LWT — «offline» на старом брокере публикуем сами
+  publishUnavailable();
+  s_mqtt.disconnect();
+  s_online  = false;
+  s_lost_ms = now | 1;
 }
 
 void mqtt_init() {
-  s_mqtt.setServer(cfg.mqtt_host, cfg.mqtt_port);
+  parseBrokers();
+  if (cfg.mqtt_tls) { tlsInit(); s_mqtt.setClient(s_tls); }
   s_mqtt.setCallback(onMessage);
+  // профиль транспорта: keep-alive, таймаут сокета, буфер (по умолчанию MQTT_MAX_PACKET_SIZE)
+  s_mqtt.setKeepAlive(cfg.mqtt_keepalive_s);
+  s_mqtt.setSocketTimeout(cfg.mqtt_timeout_s);
+  if (!s_mqtt.setBufferSize(cfg.mqtt_buf)) LOGE("mqtt: buffer %u B alloc failed", cfg.mqtt_buf);
 }
 
 bool mqtt_online() { return s_online; }
+String mqtt_broker() {
+  if (s_cur < 0) return String();
+  return String(s_brokers[s_cur].host) + ":" + String(s_brokers[s_cur].port);
+}
+const MqttStats& mqtt_stats() { return s_stats; }
+
+// Лог в <base>/debug: несколько записей за проход, без retain
+static void drainLog() {
+  static uint32_t seq = 0;
+  if (!cfg.log_mqtt) { seq = log_head(); return; }
+  if (seq < log_tail()) seq = log_tail();
+  char line[128];
+  for (uint8_t i = 0; i < 4 && seq < log_head(); i++, seq++) {
+    if (log_format(seq, line, sizeof(line))) pub(topicDebug().c_str(), line, false);
+  }
+}
 
 void mqtt_loop() {
-  if (cfg.mqtt_host[0] == '\0') { s_online = false; return; }
+  if (!s_nbrokers) { s_online = false; return; }
 
   if (s_mqtt.connected()) {
     s_online = true;
     s_mqtt.loop();
+    pingTick();
+    drainLog();
+    failbackTick();
     return;
   }
 
+  if (s_online) {
+    LOGW("mqtt: connection lost, state %d", s_mqtt.state());
+    s_lost_ms = millis() | 1;
+  }
   s_online = false;
 
-  static unsigned long lastTry = 0;
-  const unsigned long RETRY_MS = 3000;
-  unsigned long now = millis();
-  if (now - lastTry < RETRY_MS) return;
-  lastTry = now;
+  if (cfg.mqtt_tls && !s_tls_pinned) return;   // причина уже в логе из tlsInit()
+
+  // CA-пиннинг проверяет сроки сертификата — без SNTP рукопожатие заведомо не пройдёт
+  if (cfg.mqtt_tls && s_ca && !timesync_synced()) {
+    static bool warned = false;
+    if (!warned) { LOGW("mqtt: tls waits for NTP time to validate CA"); warned = true; }
+    return;
+  }
+
+  // отказавший брокер уходит в backoff, следующий проход сразу пробует другой
+  int8_t idx = brokerPick(millis());
+  if (idx < 0) return;
+  s_cur = idx;
+  Broker& b = s_brokers[idx];
+  s_mqtt.setServer(b.host, b.port);
 
   String clientId = String(cfg.device_name) + "-" + String(ESP.getChipId(), HEX);
+  uint32_t t0 = millis();
+  if (cfg.mqtt_tls && !tlsConnect(b)) { s_stats.connect_fails++; brokerFailed(b); return; }
   bool ok = s_mqtt.connect(clientId.c_str(),
                            cfg.mqtt_user[0] ? cfg.mqtt_user : nullptr,
                            cfg.mqtt_user[0] ? cfg.mqtt_pass : nullptr,
                            topicAvail().c_str(), 0, true, "offline");
+  if (!ok) {
+    s_stats.connect_fails++;
+    LOGW("mqtt: connect to %s:%u failed, state %d", b.host, b.port, s_mqtt.state());
+    brokerFailed(b);
+  }
   if (ok) {
+    // мелкие стейты не ждут в буфере Nagle
+    if (cfg.mqtt_tls) s_tls.setNoDelay(cfg.mqtt_nodelay);
+    else              s_client.setNoDelay(cfg.mqtt_nodelay);
+    s_ping_sent_ms = 0;
+    s_stats.connects++;
+    s_stats.connect_ms = millis() - t0;
+    if (s_lost_ms) { s_stats.outage_ms = millis() - s_lost_ms; s_lost_ms = 0; }
+    b.fails = 0;
+    uint32_t cms = s_stats.connect_ms | 1;
+    b.connect_ms = b.connect_ms ? (b.connect_ms * 3 + cms) / 4 : cms;
+    if (s_last_ok >= 0 && s_last_ok != idx) {
+      s_stats.failovers++;
+      s_stats.failover_ms = s_stats.outage_ms;
+      LOGW("mqtt: switched broker %s:%u, %u ms without MQTT", b.host, b.port, s_stats.failover_ms);
+    }
+    s_last_ok = idx;
+    s_stats.broker = idx;
+    s_hold_ms = millis();
+    LOGI("mqtt: connected to %s:%u in %u ms", b.host, b.port, s_stats.connect_ms);
     s_online = true;
     publishAvailability();
     sendDiscovery();
     publishMode();
     s_mqtt.subscribe(topicRelaySet().c_str());
     s_mqtt.subscribe(topicModeSet().c_str());
+    if (cfg.mqtt_ping_s) s_mqtt.subscribe(topicPing().c_str());
+    if (cfg.group_topic[0]) {
+      s_mqtt.subscribe(topicGroupRelaySet().c_str());
+      s_mqtt.subscribe(topicGroupModeSet().c_str());
+    }
     publishIp();
-    // первичный пакет стейтов
-    publishLevel(sensors_level());
-    publishError(sensors_error());
-    publishRelay(relay_get());
+    publishBroker();
+    // первичный пакет стейтов из среза; он же — база для диффа после реконнекта
+    const State& st = state();
+    publishLevel(st.level);
+    s_stats.first_state_ms = millis() - t0;
+    publishError(st.error);
+    publishRelay(st.relay);
+    if (st.analog) publishAnalog(st);
+    publishState();
+    LOGI("mqtt: first state after %u ms, discovery %u pkts / %u B", s_stats.first_state_ms,
+         s_stats.discovery_packets, s_stats.discovery_bytes);
     // и атрибуты единожды
-    String p = buildAttrPayload();
-    publishAttr_payload(p);
-    last_attr = p;
-    last_attr_pub_ms = millis();
-    // сброс/инициализация кэша (на случай реконнекта)
-    cache_init = false;
-    ensure_cache_init();
+    publishAttrNow();
+    s_sent  = st;
+    last_ip = WiFi.localIP().toString();
   }
 }
 
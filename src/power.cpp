@@ -0,0 +1,60 @@
+#include "power.h"
+#include "config.h"
+#include "sensors.h"
+
+#include <ESP8266WiFi.h>
+#include <coredecls.h>  // esp_delay
+
+// Не спим дольше секунды за раз: MQTT keep-alive (15 c) и публикации раз в 1 c
+static const uint32_t LP_MAX_SLEEP_MS = 1000;
+static const uint8_t  LP_LISTEN_DTIM  = 3;
+
+// Оценка тока (даташит ESP8266EX): CPU+модем активны ~70 мА;
+// light sleep 0.9 мА + пробуждения на DTIM-маяки — закладываем ~2 мА
+static const uint32_t LP_UA_AWAKE = 70000;
+static const uint32_t LP_UA_SLEEP = 2000;
+
+static bool     s_active   = false;
+static uint64_t s_sleep_us = 0;
+static uint64_t s_t0_us    = 0;
+
+static bool wantActive() { return cfg.low_power && cfg.mode == MODE_AUTO; }
+
+static void apply(bool on) {
+  s_active = on;
+  WiFi.setSleepMode(on ? WIFI_LIGHT_SLEEP : WIFI_NONE_SLEEP, on ? LP_LISTEN_DTIM : 0);
+}
+
+void power_init() {
+  s_t0_us = micros64();
+  if (wantActive()) apply(true);
+}
+
+void power_idle(uint32_t next_due_ms) {
+  // режим может смениться через MQTT / settings
+  if (wantActive() != s_active) apply(!s_active);
+  if (!s_active) return;
+
+  int32_t wait = (int32_t)(next_due_ms - millis());
+  if (wait <= 0) return;
+  if ((uint32_t)wait > LP_MAX_SLEEP_MS) wait = LP_MAX_SLEEP_MS;
+
+  // ISR датчиков делает esp_schedule() — выходим из сна сразу по фронту
+  uint64_t t = micros64();
+  esp_delay((uint32_t)wait, [](){ return !sensors_edge_pending(); });
+  s_sleep_us += micros64() - t;
+}
+
+bool power_active() { return s_active; }
+
+uint8_t power_awake_pct() {
+  uint64_t total = micros64() - s_t0_us;
+  if (!total) return 100;
+  uint64_t sleep = s_sleep_us > total ? total : s_sleep_us;
+  return (uint8_t)(100 - sleep * 100 / total);
+}
+
+uint32_t power_est_ua() {
+  uint32_t awake = power_awake_pct();
+  return (LP_UA_AWAKE * awake + LP_UA_SLEEP * (100 - awake)) / 100;
+}
@@ -1,19 +1,41 @@
 #include "relay.h"
 #include "hardware.h"
+#include "fastio.h"
 
-static bool g_on = false;
+static volatile bool g_on = false;   // читается из ISR отсечки (failsafe)
+static uint8_t g_pin = PIN_RELAY;
 
 void relay_init(uint8_t pin) {
-  pinMode(pin, OUTPUT);
-  digitalWrite(pin, LOW); // по умолчанию выкл
+#ifdef FIXED_HW
+  (void)pin;
+  g_pin = FIXED_PIN_RELAY;
+#else
+  g_pin = pin;
+#endif
+  pinMode(g_pin, OUTPUT);
+  digitalWrite(g_pin, LOW); // по умолчанию выкл
   g_on = false;
 }
 
 void relay_set(bool on) {
-  digitalWrite(PIN_RELAY, on ? HIGH : LOW);
+#ifdef FIXED_HW
+  FastOut<FIXED_PIN_RELAY>::write(on);
+#else
+  digitalWrite(g_pin, on ? HIGH : LOW);
+#endif
   g_on = on;
 }
 
-bool relay_get() {
+bool IRAM_ATTR relay_get() {
   return g_on;
 }
+
+// Из прерывания: только запись в пин, без логов/публикаций
+void IRAM_ATTR relay_off_isr() {
+#ifdef FIXED_HW
+  FastOut<FIXED_PIN_RELAY>::write(false);
+#else
+  digitalWrite(g_pin, LOW);
+#endif
+  g_on = false;
+}
@@ -0,0 +1,89 @@
+#include "rtcstate.h"
+#include "config.h"
+#include "state.h"
+#include "mqtt.h"
+#include "log.h"
+
+#include <LittleFS.h>
+#include <coredecls.h>  // crc32
+#include <user_interface.h>
+
+static const uint32_t RTC_MAGIC  = 0x544E4B32;  // 'TNK2' (меняется вместе с RtcSnapshot)
+static const uint32_t RTC_OFFSET = 64;          // блоки по 4 байта; начало user memory занимает eboot
+static const char*    BOOTS_PATH = "/boots";
+
+static RtcSnapshot s_saved;     // прочитанный при старте
+static RtcSnapshot s_cur;       // последний записанный
+static bool        s_warm = false;
+static uint32_t    s_cold_boots = 0;
+
+static uint32_t snapCrc(const RtcSnapshot& s) {
+  return crc32(&s, offsetof(RtcSnapshot, crc));
+}
+
+static void write(RtcSnapshot& s) {
+  s.magic = RTC_MAGIC;
+  s.crc = snapCrc(s);
+  ESP.rtcUserMemoryWrite(RTC_OFFSET, (uint32_t*)&s, sizeof(s));
+}
+
+static uint32_t bumpColdBoots() {
+  uint32_t n = 0;
+  File f = LittleFS.open(BOOTS_PATH, "r");
+  if (f) { f.read((uint8_t*)&n, sizeof(n)); f.close(); }
+  n++;
+  f = LittleFS.open(BOOTS_PATH, "w");
+  if (f) { f.write((const uint8_t*)&n, sizeof(n)); f.close(); }
+  return n;
+}
+
+bool rtcstate_begin() {
+  uint32_t reason = ESP.getResetInfoPtr()->reason;
+  bool valid = ESP.rtcUserMemoryRead(RTC_OFFSET, (uint32_t*)&s_saved, sizeof(s_saved))
+            && s_saved.magic == RTC_MAGIC && s_saved.crc == snapCrc(s_saved);
+  // при включении питания RTC-память содержит мусор — её не трогаем, даже если CRC случайно сошёлся;
+  // после сбоя снимок не доверяем: он мог и привести к падению
+  bool crash = reason == REASON_WDT_RST || reason == REASON_EXCEPTION_RST || reason == REASON_SOFT_WDT_RST;
+  s_warm = valid && !crash && reason != REASON_DEFAULT_RST && reason != REASON_DEEP_SLEEP_AWAKE;
+
+  if (s_warm) {
+    s_cur = s_saved;
+    s_cur.warm_boots++;
+    s_cold_boots = 0;
+    File f = LittleFS.open(BOOTS_PATH, "r");
+    if (f) { f.read((uint8_t*)&s_cold_boots, sizeof(s_cold_boots)); f.close(); }
+  } else {
+    memset(&s_cur, 0, sizeof(s_cur));
+    s_cold_boots = bumpColdBoots();
+  }
+  write(s_cur);
+  LOGI("rtc: %s boot, reset reason %u, warm %u cold %u", s_warm ? "warm" : "cold", reason,
+       s_cur.warm_boots, s_cold_boots);
+  return s_warm;
+}
+
+const RtcSnapshot& rtcstate_saved() { return s_saved; }
+
+void rtcstate_loop() {
+  const State& st = state();
+  RtcSnapshot n = s_cur;
+  n.s50     = st.s50;
+  n.s100    = st.s100;
+  n.relay   = st.relay;
+  n.mode    = st.mode;
+  n.seq_state = mqtt_seq_state();
+  n.seq_attr  = mqtt_seq_attr();
+  if (n.s50 == s_cur.s50 && n.s100 == s_cur.s100 && n.relay == s_cur.relay &&
+      n.mode == s_cur.mode && n.seq_state == s_cur.seq_state && n.seq_attr == s_cur.seq_attr) return;
+  s_cur = n;
+  write(s_cur);
+}
+
+void rtcstate_invalidate() {
+  memset(&s_cur, 0, sizeof(s_cur));
+  ESP.rtcUserMemoryWrite(RTC_OFFSET, (uint32_t*)&s_cur, sizeof(s_cur));
+}
+
+bool     rtcstate_warm()       { return s_warm; }
+uint32_t rtcstate_warm_boots() { return s_cur.warm_boots; }
+uint32_t rtcstate_cold_boots() { return s_cold_boots; }
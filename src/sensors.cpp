@@ -1,48 +1,122 @@
 #include "sensors.h"
 #include <Arduino.h>
-#include <math.h>  // fmodf, cosf
+#include <coredecls.h>  // esp_schedule
+#include "hardware.h"
+#include "fastio.h"
 
-static uint8_t PIN50, PIN100, LEDP;
+static uint8_t PIN50, PIN100;
 static bool TRUE_HIGH50, TRUE_HIGH100;
-static uint32_t SAMPLE_MS;
+static uint32_t SAMPLE_MS;          // быстрый период: насос вкл или есть кандидат на смену
+static uint32_t IDLE_MS;            // медленный период в простое (0 = не адаптивно)
 static uint8_t CONFIRM_N;
+static bool s_active = false;       // насос работает (задаётся из loop)
 
 static bool s50_on=false, s100_on=false;
 static uint8_t c50=0, c100=0;
 static bool cand50=false, cand100=false;
 static bool first_sample=false;
+static uint32_t t_next = 0;
+static uint32_t t_cand50 = 0, t_cand100 = 0;        // первый отсчёт кандидата
+static bool     act_cand50 = false, act_cand100 = false;
+static uint32_t s_confirm_ms[2] = {0, 0};           // [idle, active] — последняя задержка подтверждения
+static uint16_t s_win_samples = 0, s_rate_x10 = 0;  // отсчётов за окно 10 c
+static uint32_t s_win_t0 = 0;
+
+// Фронт на любом входе: будим loop() (power_idle) и снимаем первый отсчёт сразу
+static volatile bool s_edge = false;
+static void (*s_edge100_hook)() = nullptr;
+
+static void IRAM_ATTR onSensorEdge() {
+  s_edge = true;
+  esp_schedule();
+}
+
+static void IRAM_ATTR onSensorEdge100() {
+  if (s_edge100_hook) s_edge100_hook();
+  onSensorEdge();
+}
+
+static uint32_t s_sample_cyc = 0;   // EWMA тактов на отсчёт (чтение + антидребезг)
 
 static inline bool readLogic(uint8_t pin, bool true_high) {
   bool isHigh = (digitalRead(pin) == HIGH);
   return true_high ? isHigh : !isHigh;
 }
 
+#ifdef FIXED_HW
+static inline bool read50()  { return FastIn<FIXED_PIN_S50,  FIXED_S50_HIGH>::read(); }
+static inline bool read100() { return FastIn<FIXED_PIN_S100, FIXED_S100_HIGH>::read(); }
+#else
+static inline bool read50()  { return readLogic(PIN50,  TRUE_HIGH50); }
+static inline bool read100() { return readLogic(PIN100, TRUE_HIGH100); }
+#endif
+
 void sensors_init(uint8_t pin50, bool true_high50, bool pullup50,
                   uint8_t pin100, bool true_high100, bool pullup100,
-                  uint8_t led_pin, uint32_t sample_ms, uint8_t confirm_samples) {
-  PIN50 = pin50; PIN100 = pin100; LEDP = led_pin;
+                  uint32_t sample_ms, uint32_t idle_ms, uint8_t confirm_samples) {
+#ifdef FIXED_HW
+  (void)pin50; (void)pin100; (void)true_high50; (void)true_high100;
+  PIN50 = FIXED_PIN_S50; PIN100 = FIXED_PIN_S100;
+  TRUE_HIGH50 = FIXED_S50_HIGH; TRUE_HIGH100 = FIXED_S100_HIGH;
+#else
+  PIN50 = pin50; PIN100 = pin100;
   TRUE_HIGH50 = true_high50; TRUE_HIGH100 = true_high100;
+#endif
   SAMPLE_MS = sample_ms; CONFIRM_N = confirm_samples;
+  IDLE_MS = idle_ms > sample_ms ? idle_ms : 0;
 
   pinMode(PIN50,  pullup50  ? INPUT_PULLUP : INPUT);
   pinMode(PIN100, pullup100 ? INPUT_PULLUP : INPUT);
-  pinMode(LEDP, OUTPUT);
-  digitalWrite(LEDP, HIGH); // LED выкл (активен по LOW)
 
-  s50_on  = readLogic(PIN50,  TRUE_HIGH50);
-  s100_on = readLogic(PIN100, TRUE_HIGH100);
+  // GPIO16 (D0) прерываний не умеет — для него только опрос
+  if (PIN50  != 16) attachInterrupt(digitalPinToInterrupt(PIN50),  onSensorEdge, CHANGE);
+  if (PIN100 != 16) attachInterrupt(digitalPinToInterrupt(PIN100), onSensorEdge100, CHANGE);
+
+  s50_on  = read50();
+  s100_on = read100();
   first_sample = true;
 }
 
+// Антидребезг одного входа: N подтверждений подряд; фиксируем задержку подтверждения
+static void debounce(bool raw, bool& on, uint8_t& c, bool& cand,
+                     uint32_t& t_cand, bool& act_cand, uint32_t now) {
+  if (raw != on) {
+    if (c == 0) cand = raw;
+    if (raw == cand) {
+      if (c == 0) { t_cand = now; act_cand = s_active; }
+      if (++c >= CONFIRM_N) { on = raw; c = 0; s_confirm_ms[act_cand] = now - t_cand; }
+    } else { cand = raw; c = 1; t_cand = now; act_cand = s_active; }
+  } else c = 0;
+}
+
+// Быстро — пока насос работает или идёт подтверждение, иначе медленно
+static uint32_t period() {
+  if (!IDLE_MS || s_active || c50 || c100 || first_sample) return SAMPLE_MS;
+  return IDLE_MS;
+}
+
+void sensors_set_active(bool active) {
+  if (active && !s_active && (int32_t)(t_next - millis()) > (int32_t)SAMPLE_MS) t_next = millis();
+  s_active = active;
+}
+
 void sensors_tick() {
-  static uint32_t t_next = 0;
   uint32_t now = millis();
   if (t_next == 0) t_next = now;
+  // Фронт лишь начинает подтверждение: пока оно идёт, отсчёты остаются через SAMPLE_MS,
+  // иначе дребезг набирал бы CONFIRM_N отсчётов за несколько проходов loop()
+  if (s_edge) { s_edge = false; if (!c50 && !c100) t_next = now; }
   if ((int32_t)(now - t_next) < 0) return;
-  t_next += SAMPLE_MS;
 
-  bool raw50  = readLogic(PIN50,  TRUE_HIGH50);
-  bool raw100 = readLogic(PIN100, TRUE_HIGH100);
+  s_win_samples++;
+  if ((uint32_t)(now - s_win_t0) >= 10000) {
+    s_rate_x10 = s_win_samples; s_win_samples = 0; s_win_t0 = now;
+  }
+  t_next = now + SAMPLE_MS;  // после долгой паузы не догоняем; ниже уточняется по состоянию
+
+  uint32_t c0 = ESP.getCycleCount();
+  bool raw50  = read50();
+  bool raw100 = read100();
 
   if (first_sample) {
     s50_on = raw50; s100_on = raw100;
@@ -51,59 +125,32 @@ void sensors_tick() {
     return;
   }
 
-  if (raw50 != s50_on) {
-    if (c50 == 0) cand50 = raw50;
-    if (raw50 == cand50) {
-      if (++c50 >= CONFIRM_N) { s50_on = raw50; c50 = 0; }
-    } else { cand50 = raw50; c50 = 1; }
-  } else c50 = 0;
-
-  if (raw100 != s100_on) {
-    if (c100 == 0) cand100 = raw100;
-    if (raw100 == cand100) {
-      if (++c100 >= CONFIRM_N) { s100_on = raw100; c100 = 0; }
-    } else { cand100 = raw100; c100 = 1; }
-  } else c100 = 0;
+  debounce(raw50,  s50_on,  c50,  cand50,  t_cand50,  act_cand50,  now);
+  debounce(raw100, s100_on, c100, cand100, t_cand100, act_cand100, now);
+  t_next = now + period();
+
+  uint32_t dc = ESP.getCycleCount() - c0;
+  s_sample_cyc = s_sample_cyc ? s_sample_cyc + ((int32_t)(dc - s_sample_cyc) >> 4) : dc;
+}
+
+uint32_t sensors_sample_cycles() { return s_sample_cyc; }
+uint32_t sensors_period_ms()     { return period(); }
+uint16_t sensors_rate_x10()      { return s_rate_x10; }
+uint32_t sensors_confirm_ms(bool active) { return s_confirm_ms[active]; }
+
+// Тёплый старт: берём подтверждённые состояния из RTC вместо «первого отсчёта»
+void sensors_restore(bool s50, bool s100) {
+  s50_on = s50; s100_on = s100;
+  cand50 = s50; cand100 = s100;
+  c50 = 0; c100 = 0;
+  first_sample = false;
 }
 
+void     sensors_set_edge100_hook(void (*fn)()) { s_edge100_hook = fn; }
+uint32_t sensors_next_sample_ms() { return t_next; }
+bool     sensors_edge_pending()   { return s_edge; }
+
 bool sensors_s50()  { return s50_on; }
 bool sensors_s100() { return s100_on; }
 int  sensors_level(){ return s100_on ? 100 : (s50_on ? 50 : 0); }
 bool sensors_error(){ return (!s50_on && s100_on); }
-
-// LED-паттерны
-void sensors_led_tick(uint32_t now_ms) {
-  int level = sensors_level();
-  bool error = sensors_error();
-
-  if (!error) {
-    if (level == 0) {
-      digitalWrite(LEDP, HIGH);
-    } else if (level == 50) {
-      bool onPhase = ((now_ms / 1000) % 2) == 0; // 1 Гц
-      digitalWrite(LEDP, onPhase ? LOW : HIGH);
-    } else {
-      digitalWrite(LEDP, LOW);
-    }
-    return;
-  }
-
-#if defined(ESP8266)
-  if (level == 100 && LEDP != 16) {
-    const float period_s = 0.2f; // 5 Гц
-    float t = fmodf(now_ms / 1000.0f, period_s) / period_s; // 0..1
-    float y = 0.5f * (1.0f - cosf(2.0f * 3.1415926f * t));
-    int duty = (int)(y * 1023.0f);
-    analogWrite(LEDP, 1023 - duty); // активен по LOW
-    return;
-  }
-#endif
-  if (level == 100) {
-    bool onPhase = ((now_ms / 100) % 2) == 0; // 5 Гц
-    digitalWrite(LEDP, onPhase ? LOW : HIGH);
-  } else {
-    const uint32_t period_ms = 3333; // ~0.3 Гц
-    bool onPhase = (now_ms % period_ms) < (period_ms/2);
-    digitalWrite(LEDP, onPhase ? LOW : HIGH);
-  }
-}
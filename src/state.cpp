@@ -0,0 +1,60 @@
+#include "state.h"
+#include "sensors.h"
+#include "relay.h"
+#include "analog.h"
+
+#include <ESP8266WiFi.h>
+#include <ArduinoJson.h>
+
+static State    s_st;
+static uint32_t s_rssi_ms  = 0;
+static String   s_json;
+static uint32_t s_json_ver = 0;   // версия, под которую собран s_json (0 = ещё не собирали)
+
+static bool same(const State& a, const State& b) {
+  return a.level == b.level && a.error == b.error && a.s50 == b.s50 && a.s100 == b.s100 &&
+         a.relay == b.relay && a.mode == b.mode && a.analog == b.analog &&
+         a.analog_pm == b.analog_pm && a.litres == b.litres;
+}
+
+void state_update() {
+  State n = s_st;
+  n.level  = sensors_level();
+  n.error  = sensors_error();
+  n.s50    = sensors_s50();
+  n.s100   = sensors_s100();
+  n.relay  = relay_get();
+  n.mode   = cfg.mode;
+  n.analog = analog_enabled();
+  if (n.analog) {
+    // deadband здесь, чтобы шум АЦП не крутил версию и не сбрасывал кэши потребителей
+    int pm = analog_permille();
+    if (!s_st.analog || (pm != s_st.analog_pm && abs(pm - (int)s_st.analog_pm) >= cfg.analog_deadband * 10)) {
+      n.analog_pm = pm;
+      n.litres    = analog_litres();
+    }
+  }
+  uint32_t now = millis();
+  if (!s_rssi_ms || now - s_rssi_ms >= 1000) { s_rssi_ms = now | 1; n.rssi = WiFi.RSSI(); }
+
+  if (s_st.version && same(n, s_st)) { s_st.rssi = n.rssi; return; }
+  n.version = s_st.version + 1;
+  s_st = n;
+}
+
+const State& state() { return s_st; }
+
+const String& state_json() {
+  if (s_json_ver != s_st.version) {
+    StaticJsonDocument<192> d;
+    d["level"] = s_st.level;
+    d["error"] = s_st.error;
+    d["relay"] = s_st.relay;
+    d["mode"]  = state_mode_str(s_st.mode);
+    if (s_st.analog) d["analog"] = s_st.analog_pm / 10.0f;
+    s_json = "";
+    serializeJson(d, s_json);
+    s_json_ver = s_st.version;
+  }
+  return s_json;
+}
@@ -0,0 +1,57 @@
+#include "timesync.h"
+#include "config.h"
+#include "log.h"
+
+#include <time.h>
+#include <sys/time.h>
+#include <coredecls.h>  // settimeofday_cb
+
+// Эпоха до 2020 — время ещё не получено
+static const time_t VALID_EPOCH = 1577836800;
+
+static volatile bool     s_synced        = false;
+static volatile uint32_t s_syncs         = 0;
+static uint32_t          s_anchor_s      = 0;   // NTP-время последней синхронизации
+static uint16_t          s_anchor_ms     = 0;
+static uint32_t          s_anchor_millis = 0;   // millis() в тот же момент
+static int32_t           s_offset_ms     = 0;
+static int32_t           s_drift_ppm     = 0;
+
+// Вызывается SDK после установки часов (контекст SYS — без тяжёлой работы)
+static void onTimeSet(bool from_sntp) {
+  if (!from_sntp) return;
+  struct timeval tv; gettimeofday(&tv, nullptr);
+  if (tv.tv_sec < VALID_EPOCH) return;
+  uint32_t m = millis();
+
+  if (s_synced) {
+    // прогноз по millis() от прошлого якоря против фактического NTP-времени
+    uint32_t span = m - s_anchor_millis;
+    int64_t  ntp  = (int64_t)(tv.tv_sec - s_anchor_s) * 1000 + (tv.tv_usec / 1000 - s_anchor_ms);
+    s_offset_ms = (int32_t)(ntp - span);
+    if (span >= 60000) s_drift_ppm = (int32_t)((int64_t)s_offset_ms * 1000000 / span);
+  }
+  s_anchor_s = tv.tv_sec; s_anchor_ms = tv.tv_usec / 1000; s_anchor_millis = m;
+  s_synced = true;
+  s_syncs++;
+}
+
+void timesync_init() {
+  if (!cfg.ntp_server[0]) return;
+  settimeofday_cb(onTimeSet);
+  configTime(0, 0, cfg.ntp_server);
+  LOGI("ntp: server %s", cfg.ntp_server);
+}
+
+bool timesync_synced() { return s_synced; }
+
+void timesync_format_ms(char* buf, size_t len) {
+  if (!s_synced) { snprintf(buf, len, "0"); return; }
+  struct timeval tv; gettimeofday(&tv, nullptr);
+  snprintf(buf, len, "%lu%03u", (unsigned long)tv.tv_sec, (unsigned)(tv.tv_usec / 1000));
+}
+
+uint32_t timesync_syncs()     { return s_syncs; }
+uint32_t timesync_age_s()     { return s_synced ? (millis() - s_anchor_millis) / 1000 : 0; }
+int32_t  timesync_offset_ms() { return s_offset_ms; }
+int32_t  timesync_drift_ppm() { return s_drift_ppm; }
@@ -4,35 +4,114 @@
 #include "hardware.h"
 #include "sensors.h"
 #include "relay.h"
-
+#include "power.h"
+#include "analog.h"
+#include "led.h"
+#include "log.h"
+#include "failsafe.h"
+#include "timesync.h"
+#include "rtcstate.h"
+#include "state.h"
+#include "web_assets.h"
+
+#ifdef WEB_ASYNC
+#include <ESPAsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+#else
 #include <ESP8266WebServer.h>
+#endif
 #include <ESP8266mDNS.h>
-#include <ESP8266HTTPUpdateServer.h>
 #include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include <Updater.h>
+#include <LittleFS.h>
+
+#ifdef WEB_ASYNC
+// Асинхронный сервер (env nodemcuv2_async): соединения ведёт ESPAsyncTCP в контексте lwIP,
+// loop() не ждёт ни медленного клиента, ни загрузку /update. Обработчики общие с синхронным
+// сервером — пишут в www.* как в ESP8266WebServer, фасад отвечает в текущий запрос.
+// Из контекста lwIP нельзя yield()/delay() и запись в сокет MQTT — такое уходит в web_loop().
+#ifndef WEB_MAX_REQUESTS
+#define WEB_MAX_REQUESTS 4        // одновременных запросов в обработке; сверх — 503
+#endif
+#ifndef WEB_MIN_HEAP
+#define WEB_MIN_HEAP     12288    // свободной кучи на новый ответ (страница до ~7 KB + TCP)
+#endif
+
+class AsyncWww {
+public:
+  AsyncWebServerRequest* req = nullptr;
+
+  void   sendHeader(const String& name, const String& value) {
+    if (n_hdr < HDR_MAX) { hdr[n_hdr][0] = name; hdr[n_hdr][1] = value; n_hdr++; }
+  }
+  String header(const char* name)   { AsyncWebHeader* h = req->getHeader(name); return h ? h->value() : String(); }
+  bool   hasArg(const String& name) { return req->hasArg(name.c_str()); }
+  String arg(const String& name)    { return req->arg(name); }
+  bool   authenticate(const char* user, const char* pass) { return req->authenticate(user, pass); }
+  void   requestAuthentication()    { n_hdr = 0; req->requestAuthentication(); }
+  void   send(int code, const char* type = "text/plain", const String& body = String()) {
+    finish(req->beginResponse(code, type, body));
+  }
+  void   send_P(int code, const char* type, PGM_P data, size_t len) {
+    finish(req->beginResponse_P(code, type, (const uint8_t*)data, len));
+  }
+
+private:
+  static const uint8_t HDR_MAX = 4;
+  String  hdr[HDR_MAX][2];
+  uint8_t n_hdr = 0;
 
+  void finish(AsyncWebServerResponse* r) {
+    for (uint8_t i = 0; i < n_hdr; i++) r->addHeader(hdr[i][0], hdr[i][1]);
+    n_hdr = 0;
+    req->send(r);
+  }
+};
+
+static AsyncWebServer srv(80);
+static AsyncWww www;
+static uint8_t g_requests = 0;                        // ответов в полёте
+static AsyncWebServerRequest* g_ota_owner = nullptr;  // чья загрузка пишется во флеш
+static bool g_reannounce = false;                     // отложено до web_loop()
+typedef WebRequestMethodComposite WebMethod;
+#else
 static ESP8266WebServer www(80);
-static ESP8266HTTPUpdateServer httpUpdater;
+typedef HTTPMethod WebMethod;
+#endif
 static bool g_pending_reboot = false;
+static uint32_t g_reboot_at_ms = 0;   // перезагрузка по дедлайну, без delay() в обработчиках
+
+static void scheduleReboot(uint32_t after_ms) {
+  g_reboot_at_ms = millis() + after_ms;
+  g_pending_reboot = true;
+}
 
 // ---------- helpers ----------
 static String htmlHeader(const char* title) {
+  // CSS отдаётся отдельным gzip-ассетом (/style.css) с долгим кэшем —
+  // в каждой странице остаётся только ссылка (~50 B вместо ~650 B)
   String s = F("<!doctype html><meta charset='utf-8'><meta name=viewport content='width=device-width,initial-scale=1'>");
   s += "<title>"; s += title; s += "</title>";
-  s += F("<style>body{font-family:system-ui,Arial;margin:2rem;max-width:860px}"
-        "a{color:#06f;text-decoration:none} a:hover{text-decoration:underline}"
-        "code{background:#eee;padding:.1rem .3rem;border-radius:.3rem}"
-        "input,select{padding:.4rem .5rem;border:1px solid #ccc;border-radius:.5rem;width:100%;max-width:360px} "
-        "label{display:block;margin:.5rem 0 .2rem;font-weight:600}"
-        "button{padding:.45rem .8rem;border-radius:.6rem;border:0;background:#222;color:#fff;cursor:pointer}"
-        "button.secondary{background:#666}"
-        ".row{margin:.6rem 0}"
-        ".grid{display:grid;grid-template-columns:repeat(auto-fit,minmax(260px,1fr));gap:12px}"
-        ".hr{height:1px;background:#eee;margin:1rem 0}"
-        ".warn{color:#b45309}"
-        "</style>");
+  s += F("<link rel=stylesheet href='"); s += STYLE_CSS_URL;
+  s += F("?v="); s += STYLE_CSS_VER; s += F("'>");
   return s;
 }
 
+// Статический gzip-ассет из PROGMEM: ETag + immutable-кэш, 304 при совпадении
+static void sendGzAsset(const char* content_type, const uint8_t* gz, size_t len, const char* ver) {
+  String etag = String('"') + ver + '"';
+  www.sendHeader(F("Cache-Control"), F("public, max-age=31536000, immutable"));
+  www.sendHeader(F("ETag"), etag);
+  if (www.header("If-None-Match") == etag) { www.send(304); return; }
+  www.sendHeader(F("Content-Encoding"), F("gzip"));
+  www.send_P(200, content_type, (PGM_P)gz, len);
+}
+
+static void handleStyle() {
+  sendGzAsset("text/css", STYLE_CSS_GZ, STYLE_CSS_GZ_LEN, STYLE_CSS_VER);
+}
+
 static String esc(const String& in){
   String out; out.reserve(in.length()+8);
   for(char c: in){
@@ -50,8 +129,7 @@ static void rebootSoon(const String& back = "/"){
     "<meta charset='utf-8'><meta http-equiv='refresh' content='5;url="+back+"'><body>"
     "<p>Сохранено. Устройство перезагрузится через ~2 секунды…</p>"
     "<p><a href='"+back+"'>Вернуться</a></p></body>");
-  delay(500);
-  g_pending_reboot = true;
+  scheduleReboot(2000);
 }
 
 static String optionSel(int value, int selected) {
@@ -61,41 +139,147 @@ static String optionSel(int value, int selected) {
   return s;
 }
 
+// Блок состояния главной страницы: собирается один раз на версию среза
+static const String& stateHtml() {
+  static String   html;
+  static uint32_t ver = 0;
+  const State& st = state();
+  if (ver == st.version) return html;
+  ver = st.version;
+  html  = "<p>Level: <b>" + String(st.level) + "%</b></p>";
+  html += "<p>Error: <b>" + String(st.error ? "TRUE" : "FALSE") + "</b></p>";
+  if (st.analog) {
+    html += "<p>Analog: <b>" + String(st.analog_pm / 10) + "." + String(st.analog_pm % 10) + "%</b>";
+    if (cfg.tank_litres) html += ", " + String(st.litres) + " L";
+    html += "</p>";
+  }
+  html += "<p>Sensors: S50=" + String(st.s50 ? "ON" : "OFF") + ", S100=" + String(st.s100 ? "ON" : "OFF") + "</p>";
+  html += "<p>Relay: <b>" + String(st.relay ? "ON" : "OFF") + "</b></p>";
+  html += "<p>Mode: <b>" + String(state_mode_str(st.mode)) + "</b></p>";
+  return html;
+}
+
 // ---------- handlers ----------
 static void handleRoot() {
   String s = htmlHeader("Tank Controller");
   s += F("<h2>Tank Controller</h2>");
-  s += "<p>Level: <b>" + String(sensors_level()) + "%</b></p>";
-  s += "<p>Error: <b>" + String(sensors_error() ? "TRUE" : "FALSE") + "</b></p>";
-  s += "<p>Sensors: S50=" + String(sensors_s50() ? "ON" : "OFF")
-     +  ", S100=" + String(sensors_s100() ? "ON" : "OFF") + "</p>";
-  s += "<p>Relay: <b>" + String(relay_get() ? "ON" : "OFF") + "</b></p>";
-  s += "<p>Mode: <b>" + String((cfg.mode==MODE_EXTERNAL) ? "external" : "auto") + "</b></p>";
+  s += stateHtml();
+  s += "<p>Sampling: " + String(sensors_period_ms()) + " ms now, " + String(sensors_rate_x10() / 10.0f, 1)
+     + " Hz avg; confirm " + String(sensors_confirm_ms(true)) + " ms (pump on) / "
+     + String(sensors_confirm_ms(false)) + " ms (idle)";
+  if (analog_enabled()) s += "; ADC raw " + String(analog_raw());
+  s += "</p>";
   s += "<p>Wi-Fi SSID: <b>" + esc(WiFi.SSID()) + "</b>, IP <b>" + WiFi.localIP().toString()
-     + "</b>, RSSI " + String(WiFi.RSSI()) + " dBm</p>";
-  s += "<p>MQTT: " + String(mqtt_online() ? "connected" : "disconnected") + "</p>";
+     + "</b>, RSSI " + String(state().rssi) + " dBm</p>";
+  s += "<p>MQTT: " + String(mqtt_online() ? "connected" : "disconnected");
+  if (mqtt_broker().length()) s += " (" + esc(mqtt_broker()) + ")";
+  if (mqtt_stats().failovers) s += ", failovers " + String(mqtt_stats().failovers) + ", last " + String(mqtt_stats().failover_ms) + " ms";
+  if (mqtt_stats().rtt_last_ms) s += ", RTT " + String(mqtt_stats().rtt_avg_ms) + " ms (max " + String(mqtt_stats().rtt_max_ms) + ")";
+  s += "</p>";
+  if (cfg.mqtt_tls) {
+    const MqttStats& st = mqtt_stats();
+    s += "<p>TLS: full " + String(st.tls_full) + " (last " + String(st.tls_full_ms) + " ms), resumed "
+       + String(st.tls_resumed) + " (last " + String(st.tls_resumed_ms) + " ms), MFLN "
+       + String(st.tls_mfln ? "yes" : "no") + "</p>";
+  }
+  s += "<p>Boot: " + esc(ESP.getResetReason()) + (rtcstate_warm() ? " (warm)" : " (cold)")
+     + ", warm " + String(rtcstate_warm_boots()) + ", cold " + String(rtcstate_cold_boots()) + "</p>";
+  if (timesync_synced()) {
+    s += "<p>NTP: " + String(timesync_syncs()) + " syncs, last " + String(timesync_age_s()) + " s ago, offset "
+       + String(timesync_offset_ms()) + " ms, drift " + String(timesync_drift_ppm()) + " ppm</p>";
+  } else if (cfg.ntp_server[0]) {
+    s += F("<p>NTP: not synced</p>");
+  }
+  if (cfg.failsafe) {
+    s += "<p>Failsafe: " + String(failsafe_latched() ? "<b>TRIPPED</b>, " : "") + String(failsafe_trips())
+       + " trips, last " + String(failsafe_last_us()) + " us, worst " + String(failsafe_worst_us()) + " us</p>";
+  }
+  if (power_active()) {
+    s += "<p>Low-power: awake " + String(power_awake_pct()) + "%, ~"
+       + String(power_est_ua() / 1000.0f, 1) + " mA avg</p>";
+  }
   s += F("<div class='hr'></div>"
          "<p><a href='/wifi'>Wi-Fi</a> | <a href='/settings'>Settings</a> | "
          "<a href='/reannounce'>Re-announce</a> | <a href='/update'>Update firmware</a> | "
-         "<a href='/reboot'>Reboot</a></p>");
+         "<a href='/log'>Log</a> | <a href='/reboot'>Reboot</a></p>");
   www.send(200, "text/html; charset=utf-8", s);
 }
 
+// Кольцевой лог, форматируется при чтении
+static void handleLog() {
+#ifdef WEB_ASYNC
+  // Чанками прямо из кольца по мере готовности сокета: на соединение — только окно seq
+  uint32_t seq = log_tail(), end = log_head();
+  www.req->send(www.req->beginChunkedResponse("text/plain; charset=utf-8",
+    [seq, end](uint8_t* buf, size_t max, size_t) mutable -> size_t {
+      char line[129];
+      size_t n = 0;
+      if ((int32_t)(log_tail() - seq) > 0) seq = log_tail();   // кольцо успело перезаписаться
+      while (seq < end) {
+        if (!log_format(seq, line, sizeof(line) - 1)) { seq++; continue; }
+        size_t len = strlen(line);
+        if (n + len + 1 > max) break;
+        memcpy(buf + n, line, len); n += len; buf[n++] = '\n';
+        seq++;
+      }
+      if (!n && seq < end) return RESPONSE_TRY_AGAIN;   // строка не влезла в окно — позже
+      return n;                                          // 0 — конец ответа
+    }));
+#else
+  www.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  www.send(200, "text/plain; charset=utf-8", "");
+  char line[129];
+  for (uint32_t seq = log_tail(); seq < log_head(); seq++) {
+    if (!log_format(seq, line, sizeof(line) - 1)) continue;
+    size_t n = strlen(line); line[n++] = '\n';
+    www.sendContent(line, n);
+  }
+  www.sendContent("");
+#endif
+}
+
+// Счётчики MQTT-пути (JSON для стендов/мониторинга)
+static void handleMqttStats() {
+  const MqttStats& st = mqtt_stats();
+  char b[640];
+  snprintf_P(b, sizeof(b), PSTR("{\"online\":%u,\"connects\":%u,\"connect_fails\":%u,\"connect_ms\":%u,"
+             "\"first_state_ms\":%u,\"outage_ms\":%u,\"discovery_packets\":%u,\"discovery_bytes\":%u,"
+             "\"publishes\":%u,\"publish_bytes\":%u,\"publish_fails\":%u,\"rtt_last_ms\":%u,"
+             "\"rtt_avg_ms\":%u,\"rtt_max_ms\":%u,\"pings_lost\":%u,\"tls_full\":%u,\"tls_full_ms\":%u,"
+             "\"tls_resumed\":%u,\"tls_resumed_ms\":%u,\"broker\":\"%s\",\"failovers\":%u,\"failover_ms\":%u,"
+             "\"uptime_ms\":%u}"),
+             (unsigned)mqtt_online(), st.connects, st.connect_fails, st.connect_ms, st.first_state_ms,
+             st.outage_ms, st.discovery_packets, st.discovery_bytes, st.publishes, st.publish_bytes,
+             st.publish_fails, st.rtt_last_ms, st.rtt_avg_ms, st.rtt_max_ms, st.pings_lost, st.tls_full, st.tls_full_ms,
+             st.tls_resumed, st.tls_resumed_ms, mqtt_broker().c_str(), st.failovers, st.failover_ms,
+             (unsigned)millis());
+  www.send(200, "application/json", b);
+}
+
 static void handleReannounce() {
-  if (mqtt_online()) { mqtt_reannounce(); www.send(200, "text/plain", "Discovery + states re-announced"); }
-  else               { www.send(503, "text/plain", "MQTT not connected"); }
+  if (!mqtt_online()) { www.send(503, "text/plain", "MQTT not connected"); return; }
+#ifdef WEB_ASYNC
+  g_reannounce = true;   // публикует web_loop(): из контекста lwIP в сокет MQTT не пишем
+#else
+  mqtt_reannounce();
+#endif
+  www.send(200, "text/plain", "Discovery + states re-announced");
 }
 
 static void handleReboot() {
   www.send(200, "text/plain", "Rebooting...");
-  delay(300);
-  ESP.restart();
+  scheduleReboot(300);
 }
 
 // --- Wi-Fi page (смена точки доступа в STA режиме) ---
 static void handleWifiPage() {
-  int n = WiFi.scanNetworks(false, true);
+  // Асинхронный скан: первый заход запускает его и просит обновить страницу,
+  // чтобы обработчик не держал loop() ~2 c на синхронном scanNetworks()
+  int n = WiFi.scanComplete();
+  if (n == WIFI_SCAN_FAILED) { WiFi.scanNetworks(true, true); n = WIFI_SCAN_RUNNING; }
+
   String s = htmlHeader("Wi-Fi");
+  if (n == WIFI_SCAN_RUNNING) s += F("<meta http-equiv='refresh' content='3'>");
   s += F("<h2>Wi-Fi</h2>");
   s += "<p>Текущая сеть: <b>" + esc(WiFi.SSID()) + "</b></p>";
 
@@ -112,7 +296,9 @@ static void handleWifiPage() {
     s += "<li>" + esc(WiFi.SSID(i)) + " (RSSI " + String(WiFi.RSSI(i)) + " dBm"
        + (WiFi.encryptionType(i) == ENC_TYPE_NONE ? ", open" : "") + ")</li>";
   }
+  if (n == WIFI_SCAN_RUNNING) s += F("<li>Сканирование…</li>");
   s += F("</ul>");
+  if (n >= 0) WiFi.scanDelete(); // следующий заход — свежий скан
 
   s += F("<div class='hr'></div>"
          "<form method='post' action='/wifi/forget'>"
@@ -146,197 +332,311 @@ static void handleWifiForget() {
   rebootSoon("/wifi");
 }
 
-// --- Settings (MQTT + Pins) ---
-static void handleSettingsPage() {
-  auto pinSel = [](uint8_t current)->String{
-    struct Item{int val; const char* label;};
-    const Item items[] = {
-      {16,"D0 (GPIO16) ⚠ no PWM"}, {5,"D1 (GPIO5)"}, {4,"D2 (GPIO4)"},
-      {0,"D3 (GPIO0) ⚠ boot"}, {2,"D4 (GPIO2) ⚠ boot"}, {14,"D5 (GPIO14)"},
-      {12,"D6 (GPIO12)"}, {13,"D7 (GPIO13)"}, {15,"D8 (GPIO15) ⚠ boot"}
-    };
-    String s = "<select name='pin'>";
-    for (auto &it: items) {
-      s += optionSel(it.val, current) + it.label + "</option>";
-    }
-    s += "</select>";
-    return s;
-  };
-
-  auto boolSel = [](const char* name, bool val_true, const char* true_label, const char* false_label){
-    String s = "<select name='"; s += name; s += "'>";
-    s += String("<option value='1'") + (val_true?" selected":"") + ">" + true_label + "</option>";
-    s += String("<option value='0'") + (!val_true?" selected":"") + ">" + false_label + "</option>";
-    s += "</select>";
-    return s;
+// --- Settings: форма целиком строится и разбирается по CONFIG_FIELDS ---
+static String pinSel(const __FlashStringHelper* name, uint8_t current) {
+  struct Item{int val; const char* label;};
+  const Item items[] = {
+    {16,"D0 (GPIO16) ⚠ no PWM"}, {5,"D1 (GPIO5)"}, {4,"D2 (GPIO4)"},
+    {0,"D3 (GPIO0) ⚠ boot"}, {2,"D4 (GPIO2) ⚠ boot"}, {14,"D5 (GPIO14)"},
+    {12,"D6 (GPIO12)"}, {13,"D7 (GPIO13)"}, {15,"D8 (GPIO15) ⚠ boot"}
   };
+  String s = "<select name='"; s += name; s += "'>";
+  for (auto &it: items) {
+    s += optionSel(it.val, current) + it.label + "</option>";
+  }
+  s += "</select>";
+  return s;
+}
 
-  String s = htmlHeader("Settings");
-  s += F("<h2>Settings</h2>");
-
-  // MQTT блок
-  s += F("<h3>MQTT</h3><form method='post' action='/settings/save'>");
-  s += "<div class='grid'>";
-
-  s += "<div><label>Device name</label><input name='device_name' value='" + esc(cfg.device_name) + "'></div>";
-  s += "<div><label>Base topic</label><input name='base_topic' value='" + esc(cfg.base_topic) + "'></div>";
-  s += "<div><label>MQTT host</label><input name='mqtt_host' value='" + esc(cfg.mqtt_host) + "'></div>";
-  s += "<div><label>MQTT port</label><input name='mqtt_port' value='" + String(cfg.mqtt_port) + "'></div>";
-  s += "<div><label>MQTT user</label><input name='mqtt_user' value='" + esc(cfg.mqtt_user) + "'></div>";
-  s += "<div><label>MQTT password (оставь пустым — без изменений)</label><input type='password' name='mqtt_pass' value=''></div>";
-
-  s += "<div><label>Mode</label><select name='mode'>"
-       "<option value='auto' "     + String(cfg.mode==MODE_AUTO ? "selected" : "")     + ">auto</option>"
-       "<option value='external' " + String(cfg.mode==MODE_EXTERNAL ? "selected" : "") + ">external</option>"
-       "</select></div>";
+static String boolSel(const __FlashStringHelper* name, bool val_true, const char* true_label, const char* false_label) {
+  String s = "<select name='"; s += name; s += "'>";
+  s += String("<option value='1'") + (val_true?" selected":"") + ">" + true_label + "</option>";
+  s += String("<option value='0'") + (!val_true?" selected":"") + ">" + false_label + "</option>";
+  s += "</select>";
+  return s;
+}
 
-  s += "<div><label>sample_ms</label><input name='sample_ms' value='" + String(cfg.sample_ms) + "'></div>";
-  s += "<div><label>confirm_samples</label><input name='confirm_samples' value='" + String(cfg.confirm_samples) + "'></div>";
+static String fieldWidget(const CfgField& f) {
+  static const char* const BOOL_TEXT[][2] = { {"ON", "OFF"}, {"HIGH", "LOW"}, {"PULLUP", "NONE"} };
+  switch (f.type) {
+    case CF_BOOL: {
+      const uint8_t* p = (const uint8_t*)&cfg + f.offset;
+      return boolSel(FPSTR(f.key), *(const bool*)p, BOOL_TEXT[f.text][0], BOOL_TEXT[f.text][1]);
+    }
+    case CF_PIN:  return pinSel(FPSTR(f.key), *((const uint8_t*)&cfg + f.offset));
+    case CF_MODE:
+      return String("<select name='mode'>"
+                    "<option value='auto' ") + (cfg.mode == MODE_AUTO ? "selected" : "") + ">auto</option>"
+             "<option value='external' " + (cfg.mode == MODE_EXTERNAL ? "selected" : "") + ">external</option></select>";
+    default:
+      if (f.flags & CFF_SECRET) return String("<input type='password' name='") + FPSTR(f.key) + "' value=''>";
+      return String("<input name='") + FPSTR(f.key) + "' value='" + esc(cfgFieldText(f, cfg)) + "'>";
+  }
+}
 
-  s += "<div><label>Web auth user (/update)</label><input name='web_user' value='" + esc(cfg.web_user) + "'></div>";
-  s += "<div><label>Web auth pass (оставь пустым — без изменений)</label><input type='password' name='web_pass' value=''></div>";
+static void handleSettingsPage() {
+  static const char* const SECTION_TITLE[CS_COUNT] = { "MQTT", "Pins &amp; Logic", "Analog level (A0)" };
 
+  String s = htmlHeader("Settings");
+  s += F("<h2>Settings</h2><form method='post' action='/settings/save'>");
+
+  int sec = -1;
+  for (uint8_t i = 0; i < CONFIG_FIELDS_N; i++) {
+    const CfgField f = cfgField(i);
+    if (f.section != sec) {
+      if (sec >= 0) s += F("</div><div class='hr'></div>");
+      sec = f.section;
+      s += "<h3>" + String(SECTION_TITLE[sec]) + "</h3><div class='grid'>";
+    }
+    s += "<div><label>" + String(FPSTR(f.label)) + "</label>" + fieldWidget(f);
+    if (pgm_read_byte(f.hint)) {
+      s += "<div class='warn' style='margin-top:.3rem'>" + String(FPSTR(f.hint));
+      if (f.type == CF_CAL) s += ", " + String(f.min) + ".." + String(f.max) + " точек";   // из ANALOG_CAL_MAX
+      s += "</div>";
+    }
+    s += "</div>";
+    // CA брокера — файл, а не поле Config: выводим сразу за отпечатком
+    if (strcmp_P("mqtt_fp", f.key) == 0) {
+      s += "<div><label>TLS CA, PEM (" + String(LittleFS.exists(MQTT_CA_PATH) ? "задан" : "нет")
+         + "; пусто — без изменений, «-» — удалить)</label><textarea name='mqtt_ca' rows='3'></textarea></div>";
+    }
+  }
   s += "</div>";
 
-  // Пины/логика
-  s += F("<div class='hr'></div><h3>Pins & Logic</h3><div class='grid'>");
-
-  // Sensor 50%
-  s += "<div><label>Sensor 50% pin</label>";
-  s += pinSel(cfg.pin_sensor50);
-  s += "<input type='hidden' name='pin_sensor50_marker' value='1'></div>";
-
-  s += "<div><label>Sensor 50% TRUE when</label>";
-  s += boolSel("s50_true_high", cfg.s50_true_high, "HIGH", "LOW");
-  s += "</div>";
+  s += F("<div class='row'><button type='submit'>Сохранить и перезагрузить</button></div></form>");
+  s += F("<p><a href='/'>Назад</a></p>");
+  www.send(200, "text/html; charset=utf-8", s);
+}
 
-  s += "<div><label>Sensor 50% pull</label>";
-  s += boolSel("s50_pullup", cfg.s50_pullup, "PULLUP", "NONE");
-  s += "<div class='warn' style='margin-top:.3rem'>ESP8266 не поддерживает INPUT_PULLDOWN</div></div>";
+static void handleSettingsSave() {
+  // Один проход по таблице: разбор с границами в копию, затем перекрёстные правила
+  Config next = cfg;
+  for (uint8_t i = 0; i < CONFIG_FIELDS_N; i++) {
+    const CfgField f = cfgField(i);
+    String key = FPSTR(f.key);
+    if (!www.hasArg(key)) continue;
+    String v = www.arg(key); v.trim();
+    if (!v.length() && !(f.flags & CFF_EMPTY_OK)) continue;   // пусто — без изменений
+    cfgFieldParse(f, next, v);
+  }
+  cfgValidate(next);
+  cfg = next;
 
-  // Sensor 100%
-  s += "<div><label>Sensor 100% pin</label>";
-  s += pinSel(cfg.pin_sensor100);
-  s += "<input type='hidden' name='pin_sensor100_marker' value='1'></div>";
+  String ca = www.arg("mqtt_ca"); ca.trim();
+  if (ca == "-") LittleFS.remove(MQTT_CA_PATH);
+  else if (ca.length()) { File f = LittleFS.open(MQTT_CA_PATH, "w"); if (f) { f.print(ca); f.close(); } }
 
-  s += "<div><label>Sensor 100% TRUE when</label>";
-  s += boolSel("s100_true_high", cfg.s100_true_high, "HIGH", "LOW");
-  s += "</div>";
+  saveConfig();
+  rebootSoon("/settings");
+}
 
-  s += "<div><label>Sensor 100% pull</label>";
-  s += boolSel("s100_pullup", cfg.s100_pullup, "PULLUP", "NONE");
-  s += "<div class='warn' style='margin-top:.3rem'>Избегай D3/D4/D8 если не уверен (boot-пины)</div></div>";
+// --- OTA: .bin или .bin.gz (распаковывает eboot при старте), потоково во флеш ---
+// Опционально ?md5=<md5 загружаемого файла>&size=<байт> — проверяются до коммита.
+struct OtaStat {
+  uint32_t t0_ms = 0;
+  uint32_t bytes = 0;
+  bool     gz    = false;
+  bool     ok    = false;   // Update.end(true) прошёл — только тогда отвечаем OK
+  bool     active = false;  // Updater открыт, идёт запись
+  String   err;
+};
+static OtaStat g_ota;
+
+static bool otaAuthorized() {
+  if (!(cfg.web_user[0] && cfg.web_pass[0])) return true;
+  return www.authenticate(cfg.web_user, cfg.web_pass);
+}
 
-  // Factory (reset)
-  s += "<div><label>Factory/Reset pin</label>";
-  s += pinSel(cfg.pin_factory);
-  s += "<input type='hidden' name='pin_factory_marker' value='1'></div>";
+static void handleUpdatePage() {
+  if (!otaAuthorized()) return www.requestAuthentication();
+  String s = htmlHeader("Update");
+  s += F("<h2>Update firmware</h2>"
+         "<form method='post' action='/update' enctype='multipart/form-data'"
+         " onsubmit=\"this.action='/update?md5='+encodeURIComponent(this.md5.value)\">"
+         "<div class='row'><label>Firmware (.bin или .bin.gz)</label>"
+         "<input type='file' name='firmware' accept='.bin,.gz' required></div>"
+         "<div class='row'><label>MD5 файла (необязательно)</label>"
+         "<input name='md5' placeholder='32 hex'></div>"
+         "<div class='row'><button type='submit'>Загрузить</button></div></form>"
+         "<p><a href='/'>Назад</a></p>");
+  www.send(200, "text/html; charset=utf-8", s);
+}
 
-  s += "<div><label>Factory active when</label>";
-  s += boolSel("factory_true_high", cfg.factory_true_high, "HIGH", "LOW");
-  s += "</div>";
+// Общие шаги загрузки для обоих серверов; обработчик только раскладывает по ним чанки
+static void otaStart(bool authorized, String md5) {
+  g_ota = OtaStat();
+  g_ota.t0_ms = millis();
+  if (!authorized) { g_ota.err = F("unauthorized"); return; }
+  WiFiUDP::stopAll();
+  uint32_t maxSpace = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
+  if (!Update.begin(maxSpace, U_FLASH)) { g_ota.err = Update.getErrorString(); return; }
+  g_ota.active = true;
+  led_set_state(LED_OTA);
+  md5.trim();
+  if (md5.length() && !Update.setMD5(md5.c_str())) { g_ota.err = F("bad md5"); Update.end(false); }
+}
 
-  s += "<div><label>Factory pull</label>";
-  s += boolSel("factory_pullup", cfg.factory_pullup, "PULLUP", "NONE");
-  s += "<div class='warn' style='margin-top:.3rem'>Для активного LOW обычно выбирают PULLUP</div></div>";
+static void otaWrite(const uint8_t* buf, size_t len) {
+  if (g_ota.err.length()) return;
+  if (g_ota.bytes == 0 && len >= 2) g_ota.gz = (buf[0] == 0x1f && buf[1] == 0x8b);
+  if (Update.write(const_cast<uint8_t*>(buf), len) != len) {
+    g_ota.err = Update.getErrorString();
+    Update.end(false);
+  }
+  g_ota.bytes += len;
+}
 
-  s += "</div>";
+static void otaEnd(const String& size_s) {
+  g_ota.active = false;
+  if (g_ota.err.length()) return;
+  if (size_s.length() && (uint32_t)size_s.toInt() != g_ota.bytes) {
+    g_ota.err = F("size mismatch");
+    Update.end(false);
+    return;
+  }
+  if (!Update.end(true)) g_ota.err = Update.getErrorString(); // здесь же сверка MD5
+  else                   g_ota.ok  = true;
+}
 
-  s += F("<div class='row'><button type='submit'>Сохранить и перезагрузить</button></div></form>");
-  s += F("<p><a href='/'>Назад</a></p>");
-  www.send(200, "text/html; charset=utf-8", s);
+static void otaAbort() {
+  g_ota.active = false;
+  g_ota.err = F("aborted");
+  Update.end(false);
 }
 
-static void handleSettingsSave() {
-  // MQTT / базовые
-  auto argb = [&](const char* k){ String v = www.arg(k); v.trim(); return v; };
-
-  String device_name = argb("device_name");
-  String base_topic  = argb("base_topic");
-  String mqtt_host   = argb("mqtt_host");
-  String mqtt_port_s = argb("mqtt_port");
-  String mqtt_user   = argb("mqtt_user");
-  String mqtt_pass   = argb("mqtt_pass");
-  String mode_s      = argb("mode");
-  String sample_ms_s = argb("sample_ms");
-  String confirm_s   = argb("confirm_samples");
-  String web_user    = argb("web_user");
-  String web_pass    = argb("web_pass");
-
-  if (device_name.length()) strlcpy(cfg.device_name, device_name.c_str(), sizeof(cfg.device_name));
-  if (base_topic.length())  strlcpy(cfg.base_topic,  base_topic.c_str(),  sizeof(cfg.base_topic));
-  if (mqtt_host.length())   strlcpy(cfg.mqtt_host,   mqtt_host.c_str(),   sizeof(cfg.mqtt_host));
-  if (mqtt_user.length())   strlcpy(cfg.mqtt_user,   mqtt_user.c_str(),   sizeof(cfg.mqtt_user));
-  if (web_user.length())    strlcpy(cfg.web_user,    web_user.c_str(),    sizeof(cfg.web_user));
-
-  if (mqtt_port_s.length()) {
-    uint16_t p = (uint16_t) mqtt_port_s.toInt(); if (!p) p = 1883; cfg.mqtt_port = p;
+#ifdef WEB_ASYNC
+// Тело multipart приходит чанками из контекста lwIP; пишет во флеш только один запрос
+static void handleUpdateUpload(AsyncWebServerRequest* r, const String&, size_t index,
+                               uint8_t* data, size_t len, bool final) {
+  if (index == 0) {
+    if (g_ota_owner) return;                 // идёт чужая загрузка — эту не трогаем
+    g_ota_owner = r;
+    r->onDisconnect([r]() { if (g_ota_owner == r) { otaAbort(); g_ota_owner = nullptr; } });
+    www.req = r;
+    otaStart(otaAuthorized(), r->arg("md5"));
+    www.req = nullptr;
   }
-  if (mqtt_pass.length()) { strlcpy(cfg.mqtt_pass, mqtt_pass.c_str(), sizeof(cfg.mqtt_pass)); }
-  if (web_pass.length())  { strlcpy(cfg.web_pass,  web_pass.c_str(),  sizeof(cfg.web_pass)); }
-
-  cfg.mode = (mode_s == "external") ? MODE_EXTERNAL : MODE_AUTO;
-
-  if (sample_ms_s.length())      { uint32_t v = (uint32_t) sample_ms_s.toInt(); if (!v) v = 50; cfg.sample_ms = v; }
-  if (confirm_s.length())        { uint8_t v = (uint8_t)  confirm_s.toInt();   if (!v) v = 3;  cfg.confirm_samples = v; }
-
-  // Пины/инверсии/подтяжки
-  if (www.hasArg("pin_sensor50_marker"))  { cfg.pin_sensor50   = (uint8_t) www.arg("pin").toInt(); } // см. порядок форм — каждый блок формируется отдельно
-  if (www.hasArg("s50_true_high"))        { cfg.s50_true_high  = www.arg("s50_true_high") == "1"; }
-  if (www.hasArg("s50_pullup"))           { cfg.s50_pullup     = www.arg("s50_pullup") == "1"; }
-
-  // Из-за одинакового name='pin' у трёх селектов читаем по порядку:
-  // второй селект pin = sensor100
-  int pin_fields_seen = 0;
-  for (uint8_t i = 0; i < www.args(); ++i) {
-    if (www.argName(i) == "pin") {
-      if (pin_fields_seen == 0 && www.hasArg("pin_sensor50_marker")) { pin_fields_seen++; continue; }
-      if (pin_fields_seen == 0) { cfg.pin_sensor50 = (uint8_t) www.arg(i).toInt(); pin_fields_seen++; continue; }
-      if (pin_fields_seen == 1) { cfg.pin_sensor100 = (uint8_t) www.arg(i).toInt(); pin_fields_seen++; continue; }
-      if (pin_fields_seen == 2) { cfg.pin_factory   = (uint8_t) www.arg(i).toInt(); pin_fields_seen++; continue; }
-    }
+  if (g_ota_owner != r) return;
+  if (len) otaWrite(data, len);
+  if (final) otaEnd(r->arg("size"));
+}
+#else
+static void handleUpdateUpload() {
+  HTTPUpload& up = www.upload();
+
+  if (up.status == UPLOAD_FILE_START) {
+    otaStart(otaAuthorized(), www.arg("md5"));
+  } else if (up.status == UPLOAD_FILE_WRITE) {
+    otaWrite(up.buf, up.currentSize);
+    led_tick(millis()); // loop() стоит всю загрузку — LED крутим отсюда
+  } else if (up.status == UPLOAD_FILE_END) {
+    otaEnd(www.arg("size"));
+  } else if (up.status == UPLOAD_FILE_ABORTED) {
+    otaAbort();
   }
+}
+#endif
+
+static void handleUpdateDone() {
+  if (!otaAuthorized()) return www.requestAuthentication();
+  // POST без файла не проходит через handleUpdateUpload(): g_ota пустой или от прошлой загрузки
+  OtaStat ota = g_ota;
+  g_ota = OtaStat();   // результат отдаём один раз
+  if (!ota.ok && !ota.err.length()) { www.send(400, "text/plain", "No firmware uploaded"); return; }
+  uint32_t ms  = millis() - ota.t0_ms;
+  uint32_t bps = ms ? (uint32_t)((uint64_t)ota.bytes * 1000 / ms) : 0;
+  if (ota.err.length()) LOGE("OTA failed after %u B, updater error %d", ota.bytes, Update.getError());
+  else                  LOGI("OTA: %u B gz=%u in %u ms (%u B/s)", ota.bytes, (unsigned)ota.gz, ms, bps);
+
+  String s = String(ota.bytes) + " B" + (ota.gz ? " (gzip)" : "") + ", "
+           + String(ms) + " ms, " + String(bps) + " B/s\n";
+  if (ota.err.length()) {
+    www.send(500, "text/plain", "Update failed: " + ota.err + "\n" + s);
+    return;
+  }
+  www.send(200, "text/plain", "Update OK, rebooting...\n" + s);
+  scheduleReboot(1000);
+}
 
-  if (www.hasArg("s100_true_high"))       { cfg.s100_true_high = www.arg("s100_true_high") == "1"; }
-  if (www.hasArg("s100_pullup"))          { cfg.s100_pullup    = www.arg("s100_pullup") == "1"; }
+#ifdef WEB_ASYNC
+// Допуск: не больше WEB_MAX_REQUESTS ответов в полёте и запас кучи — иначе сразу 503,
+// чтобы пачка клиентов не выела память под страницы и TCP-буферы
+static bool admit(AsyncWebServerRequest* r) {
+  if (g_requests >= WEB_MAX_REQUESTS || ESP.getFreeHeap() < WEB_MIN_HEAP) {
+    r->send(503, "text/plain", "Busy");
+    return false;
+  }
+  g_requests++;
+  r->onDisconnect([]() { g_requests--; });
+  return true;
+}
 
-  if (www.hasArg("factory_true_high"))    { cfg.factory_true_high = www.arg("factory_true_high") == "1"; }
-  if (www.hasArg("factory_pullup"))       { cfg.factory_pullup    = www.arg("factory_pullup") == "1"; }
+static void route(const char* uri, WebMethod method, void (*fn)()) {
+  srv.on(uri, method, [fn](AsyncWebServerRequest* r) {
+    if (!admit(r)) return;
+    www.req = r; fn(); www.req = nullptr;
+  });
+}
 
-  saveConfig();
-  rebootSoon("/settings");
+// Итог загрузки: без admit() — прошивка уже во флеше, 503 здесь потерял бы перезагрузку
+static void handleUpdatePost(AsyncWebServerRequest* r) {
+  www.req = r;
+  if (g_ota_owner && g_ota_owner != r) www.send(409, "text/plain", "Another update in progress");
+  else { g_ota_owner = nullptr; handleUpdateDone(); }
+  www.req = nullptr;
+}
+#else
+static void route(const char* uri, WebMethod method, void (*fn)()) {
+  www.on(uri, method, fn);
 }
+#endif
 
 void web_init() {
   if (MDNS.begin(cfg.device_name)) MDNS.addService("http", "tcp", 80);
 
-  www.on("/", handleRoot);
-  www.on("/reannounce", HTTP_GET, handleReannounce);
-  www.on("/reboot",     HTTP_GET, handleReboot);
+  route("/",           HTTP_ANY, handleRoot);
+  route(STYLE_CSS_URL, HTTP_GET, handleStyle);
+  route("/reannounce", HTTP_GET, handleReannounce);
+  route("/reboot",     HTTP_GET, handleReboot);
+  route("/log",        HTTP_GET, handleLog);
+  route("/mqtt/stats", HTTP_GET, handleMqttStats);
 
   // Wi-Fi
-  www.on("/wifi",        HTTP_GET, handleWifiPage);
-  www.on("/wifi/save",   HTTP_POST, handleWifiSave);
-  www.on("/wifi/forget", HTTP_POST, handleWifiForget);
+  route("/wifi",        HTTP_GET, handleWifiPage);
+  route("/wifi/save",   HTTP_POST, handleWifiSave);
+  route("/wifi/forget", HTTP_POST, handleWifiForget);
 
   // Settings (MQTT + Pins)
-  www.on("/settings",      HTTP_GET,  handleSettingsPage);
-  www.on("/settings/save", HTTP_POST, handleSettingsSave);
-
-  // /update — OTA .bin
-  if (cfg.web_user[0] && cfg.web_pass[0]) {
-    httpUpdater.setup(&www, "/update", cfg.web_user, cfg.web_pass);
-  } else {
-    httpUpdater.setup(&www, "/update");
-  }
+  route("/settings",      HTTP_GET,  handleSettingsPage);
+  route("/settings/save", HTTP_POST, handleSettingsSave);
+
+  // /update — OTA .bin / .bin.gz
+  route("/update", HTTP_GET, handleUpdatePage);
+#ifdef WEB_ASYNC
+  srv.on("/update", HTTP_POST, handleUpdatePost, handleUpdateUpload);
+  srv.begin();   // заголовки запроса ESPAsyncWebServer хранит все сам
+#else
+  www.on("/update", HTTP_POST, handleUpdateDone, handleUpdateUpload);
+
+  static const char* hdrs[] = { "If-None-Match" };
+  www.collectHeaders(hdrs, 1);
 
+  www.enableDelay(false); // без delay(1) в handleClient() при отсутствии клиентов
   www.begin();
+#endif
 }
 
 void web_loop() {
+#ifdef WEB_ASYNC
+  if (g_reannounce) { g_reannounce = false; if (mqtt_online()) mqtt_reannounce(); }
+#else
   www.handleClient();
-  if (g_pending_reboot) {
-    delay(1500);
+#endif
+  if (g_pending_reboot && (int32_t)(millis() - g_reboot_at_ms) >= 0) {
     ESP.restart();
   }
 }
+
+bool web_ota_active() {
+  return g_ota.active;
+}
@@ -0,0 +1,187 @@
+// Хостовый стенд MQTT-пути: настоящий src/mqtt.cpp + PubSubClient поверх POSIX-сокетов
+// против брокера в процессе (или внешнего — --external). Печатает базовую линию:
+//   1) connect -> первый стейт, объём discovery (пакеты/байты) — со стороны прошивки и брокера;
+//   2) публикаций/с через mqtt_publish_diff() при смене среза и цена холостого диффа;
+//   3) «убийство» брокера и подъём через --down мс: обнаружение разрыва, восстановление, outage.
+#include "broker.h"
+#include "host.h"
+#include "config.h"
+#include "mqtt.h"
+#include "state.h"
+
+#include <chrono>
+#include <thread>
+
+static uint32_t arg_u(int& i, int argc, char** argv) { return i + 1 < argc ? (uint32_t)strtoul(argv[++i], nullptr, 10) : 0; }
+
+static void usage() {
+  fprintf(stderr,
+    "mqtt_bench [-p port] [-n iterations] [--down ms] [--external host:port] [--broker-only] [-v]\n"
+    "  -p            порт брокера в процессе (18830)\n"
+    "  -n            итераций смены среза для publishes/s (2000)\n"
+    "  --down        сколько мс брокер лежит в тесте реконнекта (2000)\n"
+    "  --external    внешний брокер (mosquitto); тест реконнекта пропускается\n"
+    "  --broker-only только брокер на -p: проверка совместимости сторонними клиентами\n"
+    "  -v            лог прошивки в stderr\n");
+}
+
+// Крутим mqtt_loop(), пока cond() не станет true; false — таймаут
+template <typename C>
+static bool spin(uint32_t timeout_ms, C cond) {
+  uint32_t t0 = millis();
+  while (!cond()) {
+    if (millis() - t0 >= timeout_ms) return false;
+    mqtt_loop();
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  return true;
+}
+
+// Брокер дочитал всё, что отправлено: его счётчик PUBLISH догнал счётчик прошивки
+static bool drained(MiniBroker& br, uint32_t base_dev, uint32_t base_br, uint32_t timeout_ms) {
+  uint32_t t0 = millis();
+  while (br.stats().publishes - base_br < mqtt_stats().publishes - base_dev) {
+    if (millis() - t0 >= timeout_ms) return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  uint16_t port = 18830;
+  uint32_t iters = 2000, down_ms = 2000;
+  const char* external = nullptr;
+  bool broker_only = false;
+  host_log_quiet = true;
+  for (int i = 1; i < argc; i++) {
+    String a = argv[i];
+    if      (a == "-p")            port = (uint16_t)arg_u(i, argc, argv);
+    else if (a == "-n")            iters = arg_u(i, argc, argv);
+    else if (a == "--down")        down_ms = arg_u(i, argc, argv);
+    else if (a == "--external")    external = i + 1 < argc ? argv[++i] : nullptr;
+    else if (a == "--broker-only") broker_only = true;
+    else if (a == "-v")            host_log_quiet = false;
+    else { usage(); return 2; }
+  }
+
+  MiniBroker br;
+  if (!external) {
+    if (!br.start(port)) { fprintf(stderr, "broker: bind 127.0.0.1:%u failed\n", port); return 1; }
+    br.set_state_topic(String(cfg.base_topic).str() + "/level/state");
+  }
+  if (broker_only) {
+    printf("broker on 127.0.0.1:%u, Ctrl+C to stop\n", port);
+    for (;;) {
+      std::this_thread::sleep_for(std::chrono::seconds(5));
+      BrokerStats s = br.stats();
+      printf("connects %u, packets %u, publishes %u (%u B), subscribes %u, pings %u, wills %u\n",
+             s.connects, s.packets, s.publishes, s.publish_bytes, s.subscribes, s.pings, s.wills);
+      fflush(stdout);
+    }
+  }
+
+  if (external) {
+    const char* colon = strchr(external, ':');
+    size_t n = colon ? (size_t)(colon - external) : strlen(external);
+    snprintf(cfg.mqtt_host, sizeof(cfg.mqtt_host), "%.*s", (int)n, external);
+    cfg.mqtt_port = colon ? (uint16_t)atoi(colon + 1) : 1883;
+  } else {
+    snprintf(cfg.mqtt_host, sizeof(cfg.mqtt_host), "127.0.0.1");
+    cfg.mqtt_port = port;
+  }
+  cfg.ntp_server[0] = '\0';
+  printf("broker %s:%u, PubSubClient buffer %u B, keep-alive %u s, nodelay %u\n",
+         cfg.mqtt_host, cfg.mqtt_port, cfg.mqtt_buf, cfg.mqtt_keepalive_s, (unsigned)cfg.mqtt_nodelay);
+
+  // ---- 1. connect -> первый стейт, discovery ----
+  mqtt_init();
+  state_update();
+  auto t_conn = std::chrono::steady_clock::now();
+  if (!spin(10000, [] { return mqtt_online(); })) {
+    printf("FAIL: no MQTT session in 10 s (connect fails %u)\n", mqtt_stats().connect_fails);
+    return 1;
+  }
+  double up_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t_conn).count();
+  const MqttStats& ms = mqtt_stats();
+  printf("\n[connect]\n");
+  printf("session up           %.0f us wall (TCP + CONNECT + discovery + initial states)\n", up_us);
+  printf("connect_ms           %u\n", ms.connect_ms);
+  printf("first_state_ms       %u   (device: connect() start -> level/state sent)\n", ms.first_state_ms);
+  printf("discovery            %u packets, %u B (device accounting)\n", ms.discovery_packets, ms.discovery_bytes);
+  printf("initial burst        %u publishes, %u B\n", ms.publishes, ms.publish_bytes);
+  if (!external) {
+    if (!drained(br, 0, 0, 2000)) printf("WARN: broker saw fewer publishes than sent\n");
+    BrokerStats bs = br.stats();
+    printf("broker first state   %u ms after TCP accept\n", bs.first_state_ms ? bs.first_state_ms - bs.accept_ms : 0);
+    printf("broker discovery     %u packets, %u B%s\n", bs.discovery_packets, bs.discovery_bytes,
+           bs.discovery_bytes == ms.discovery_bytes ? "  (matches device)" : "  (MISMATCH)");
+    printf("broker received      %u packets: %u publishes (%u B), %u subscribes\n",
+           bs.packets, bs.publishes, bs.publish_bytes, bs.subscribes);
+  }
+
+  // ---- 2. publishes/s через mqtt_publish_diff() ----
+  uint32_t p0 = ms.publishes, b0 = ms.publish_bytes, f0 = ms.publish_fails;
+  uint32_t br0 = external ? 0 : br.stats().publishes;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iters; i++) {
+    plant.relay = !plant.relay;          // каждый шаг — новая версия среза
+    if (i % 8 == 0) plant.s50 = !plant.s50;
+    state_update();
+    mqtt_publish_diff();
+    mqtt_loop();
+  }
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  uint32_t pubs = ms.publishes - p0;
+  printf("\n[publish_diff]\n");
+  printf("iterations           %u in %.3f s, %.2f publishes/iteration\n", iters, sec, iters ? (double)pubs / iters : 0.0);
+  printf("publishes            %u (%u B), fails %u\n", pubs, ms.publish_bytes - b0, ms.publish_fails - f0);
+  printf("publishes/s          %.0f  (%.0f B/s)\n", pubs / sec, (ms.publish_bytes - b0) / sec);
+  if (!external) {
+    bool ok = drained(br, p0, br0, 5000);
+    double e2e = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("broker received      %u%s, end-to-end %.0f publishes/s\n", br.stats().publishes - br0,
+           ok ? "" : " (INCOMPLETE)", pubs / e2e);
+  }
+  // холостой дифф: срез не меняется — только сравнения, без публикаций
+  p0 = ms.publishes;
+  t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iters * 10; i++) { state_update(); mqtt_publish_diff(); }
+  sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  printf("idle diff            %.2f us/call, %u publishes\n", sec * 1e6 / (iters * 10), ms.publishes - p0);
+
+  if (external) {
+    printf("\n[reconnect] skipped with --external: restart the broker by hand and watch -v\n");
+    return 0;
+  }
+
+  // ---- 3. брокер убит и поднят через down_ms ----
+  printf("\n[reconnect]\n");
+  uint32_t fails0 = ms.connect_fails, connects0 = ms.connects, p_kill = ms.publishes;
+  br.reset_stats();
+  uint32_t t_kill = millis();
+  br.stop();
+  if (!spin(cfg.mqtt_keepalive_s * 2000UL, [] { return !mqtt_online(); })) {
+    printf("FAIL: loss not detected within 2x keep-alive\n");
+    return 1;
+  }
+  printf("loss detected        %u ms after kill\n", millis() - t_kill);
+  spin(down_ms, [&] { return millis() - t_kill >= down_ms; });
+  uint32_t t_up = millis();
+  if (!br.start(port)) { printf("FAIL: broker restart on %u\n", port); return 1; }
+  if (!spin(60000, [] { return mqtt_online(); })) {
+    printf("FAIL: no reconnect within 60 s after restart\n");
+    return 1;
+  }
+  printf("broker down          %u ms\n", t_up - t_kill);
+  printf("online again         %u ms after restart (connect attempts failed meanwhile: %u)\n",
+         millis() - t_up, ms.connect_fails - fails0);
+  printf("outage_ms            %u   (device: loss -> online)\n", ms.outage_ms);
+  printf("connects             +%u, first_state_ms %u\n", ms.connects - connects0, ms.first_state_ms);
+  drained(br, p_kill, 0, 2000);   // дождаться повторного анонса
+  BrokerStats bs = br.stats();
+  printf("re-announce          %u publishes (%u B), discovery %u packets\n",
+         bs.publishes, bs.publish_bytes, bs.discovery_packets);
+  std::string avail = br.retained(String(cfg.base_topic).str() + "/status");
+  printf("retained status      \"%s\"\n", avail.c_str());
+  return 0;
+}
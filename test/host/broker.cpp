@@ -0,0 +1,207 @@
+#include "broker.h"
+
+#include <Arduino.h>   // millis()
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static std::string packet(uint8_t hdr, const std::string& body) {
+  std::string p(1, (char)hdr);
+  size_t n = body.size();
+  do { uint8_t b = n % 128; n /= 128; p += (char)(n ? b | 0x80 : b); } while (n);
+  return p + body;
+}
+
+static std::string str16(const std::string& s) {
+  return std::string(1, (char)(s.size() >> 8)) + (char)(s.size() & 0xFF) + s;
+}
+
+// Строка с 16-битной длиной из body[pos]; false — пакет обрезан
+static bool take16(const std::string& b, size_t& pos, std::string& out) {
+  if (pos + 2 > b.size()) return false;
+  size_t n = (uint8_t)b[pos] << 8 | (uint8_t)b[pos + 1];
+  if (pos + 2 + n > b.size()) return false;
+  out = b.substr(pos + 2, n);
+  pos += 2 + n;
+  return true;
+}
+
+static void sendAll(int fd, const std::string& p) {
+  size_t done = 0;
+  while (done < p.size()) {
+    ssize_t k = send(fd, p.data() + done, p.size() - done, MSG_NOSIGNAL);
+    if (k <= 0) return;
+    done += (size_t)k;
+  }
+}
+
+bool MiniBroker::start(uint16_t port) {
+  if (running()) return true;
+  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(port);
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(listen_fd_, (sockaddr*)&a, sizeof(a)) < 0 || listen(listen_fd_, 8) < 0) {
+    close(listen_fd_); listen_fd_ = -1;
+    return false;
+  }
+  if (pipe(wake_) < 0) { close(listen_fd_); listen_fd_ = -1; return false; }
+  thread_ = std::thread(&MiniBroker::run, this);
+  return true;
+}
+
+void MiniBroker::stop() {
+  if (!running()) return;
+  char c = 0;
+  (void)!write(wake_[1], &c, 1);
+  thread_.join();
+  // как kill -9: сокеты закрываются без DISCONNECT, LWT публиковать уже некому
+  for (auto& s : sessions_) close(s.fd);
+  sessions_.clear();
+  close(listen_fd_); listen_fd_ = -1;
+  close(wake_[0]); close(wake_[1]); wake_[0] = wake_[1] = -1;
+}
+
+void MiniBroker::set_state_topic(const std::string& t) { std::lock_guard<std::mutex> l(mu_); state_topic_ = t; }
+BrokerStats MiniBroker::stats()                        { std::lock_guard<std::mutex> l(mu_); return st_; }
+void MiniBroker::reset_stats()                         { std::lock_guard<std::mutex> l(mu_); st_ = BrokerStats(); }
+
+std::string MiniBroker::retained(const std::string& topic) {
+  std::lock_guard<std::mutex> l(mu_);
+  auto it = retained_.find(topic);
+  return it == retained_.end() ? std::string() : it->second;
+}
+
+void MiniBroker::run() {
+  std::vector<pollfd> pfd;
+  for (;;) {
+    pfd.clear();
+    pfd.push_back({ wake_[0], POLLIN, 0 });
+    pfd.push_back({ listen_fd_, POLLIN, 0 });
+    for (auto& s : sessions_) pfd.push_back({ s.fd, POLLIN, 0 });
+    if (poll(pfd.data(), pfd.size(), -1) < 0) continue;
+    if (pfd[0].revents) return;
+
+    std::lock_guard<std::mutex> l(mu_);
+    if (pfd[1].revents & POLLIN) {
+      int fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd >= 0) { Session s; s.fd = fd; sessions_.push_back(s); st_.accept_ms = millis(); st_.first_state_ms = 0; }
+    }
+    // с конца: drop() удаляет сессию из вектора
+    for (size_t i = pfd.size() - 1; i >= 2; i--) {
+      if (!pfd[i].revents) continue;
+      size_t si = i - 2;
+      if (si >= sessions_.size()) continue;
+      Session& s = sessions_[si];
+      char buf[4096];
+      ssize_t k = recv(s.fd, buf, sizeof(buf), 0);
+      if (k <= 0) { drop(si); continue; }
+      s.in.append(buf, (size_t)k);
+      // разбор всех целых пакетов из буфера
+      for (;;) {
+        size_t pos = 1, len = 0, mul = 1;
+        bool complete = false;
+        while (pos < s.in.size() && pos <= 4) {
+          uint8_t b = (uint8_t)s.in[pos++];
+          len += (b & 0x7F) * mul; mul *= 128;
+          if (!(b & 0x80)) { complete = true; break; }
+        }
+        if (!complete || s.in.size() < pos + len) break;
+        uint8_t hdr = (uint8_t)s.in[0];
+        std::string body = s.in.substr(pos, len);
+        s.in.erase(0, pos + len);
+        if (!handle(s, hdr, body, pos + len)) { drop(si); break; }
+      }
+    }
+  }
+}
+
+// false — закрыть сессию (DISCONNECT или мусор)
+bool MiniBroker::handle(Session& s, uint8_t hdr, const std::string& b, size_t wire) {
+  st_.packets++;
+  size_t pos = 0;
+  switch (hdr >> 4) {
+    case 1: {   // CONNECT
+      std::string proto, id;
+      if (!take16(b, pos, proto) || pos + 4 > b.size()) return false;
+      uint8_t flags = (uint8_t)b[pos + 1];
+      pos += 4;   // level, flags, keep-alive
+      if (!take16(b, pos, id)) return false;
+      if (flags & 0x04) {
+        s.has_will = take16(b, pos, s.will_topic) && take16(b, pos, s.will_msg);
+        s.will_retain = flags & 0x20;
+      }
+      st_.connects++;
+      sendAll(s.fd, packet(0x20, std::string("\0\0", 2)));
+      return true;
+    }
+    case 3: {   // PUBLISH
+      std::string topic;
+      if (!take16(b, pos, topic)) return false;
+      if ((hdr >> 1) & 3) pos += 2;   // QoS>0: packet id (прошивка шлёт QoS0)
+      std::string payload = b.substr(pos);
+      uint32_t now = millis();
+      st_.publishes++;
+      st_.publish_bytes += wire;
+      st_.last_publish_ms = now;
+      if (topic.compare(0, 14, "homeassistant/") == 0) { st_.discovery_packets++; st_.discovery_bytes += wire; }
+      if (!st_.first_state_ms && topic == state_topic_) st_.first_state_ms = now | 1;
+      route(topic, payload, hdr & 1);
+      return true;
+    }
+    case 8: {   // SUBSCRIBE
+      if (b.size() < 2) return false;
+      std::string ack = b.substr(0, 2);   // packet id
+      pos = 2;
+      std::string filter;
+      while (take16(b, pos, filter) && pos < b.size()) {
+        pos++;   // запрошенный QoS
+        s.subs.push_back(filter);
+        ack += '\0';
+        st_.subscribes++;
+        auto it = retained_.find(filter);
+        if (it != retained_.end()) sendAll(s.fd, packet(0x31, str16(it->first) + it->second));
+      }
+      sendAll(s.fd, packet(0x90, ack));
+      return true;
+    }
+    case 12:    // PINGREQ
+      st_.pings++;
+      sendAll(s.fd, packet(0xD0, ""));
+      return true;
+    case 14:    // DISCONNECT: LWT не публикуется
+      s.has_will = false;
+      return false;
+    default:
+      return true;
+  }
+}
+
+// Доставка по точному совпадению фильтра — прошивка подписывается без масок
+void MiniBroker::route(const std::string& topic, const std::string& payload, bool retain) {
+  if (retain) {
+    if (payload.empty()) retained_.erase(topic);
+    else                 retained_[topic] = payload;
+  }
+  std::string p = packet(0x30, str16(topic) + payload);
+  for (auto& s : sessions_) {
+    for (auto& f : s.subs) {
+      if (f == topic) { sendAll(s.fd, p); break; }
+    }
+  }
+}
+
+// Обрыв без DISCONNECT — публикуем LWT, как настоящий брокер
+void MiniBroker::drop(size_t i) {
+  Session s = sessions_[i];
+  sessions_.erase(sessions_.begin() + i);
+  close(s.fd);
+  if (s.has_will) { st_.wills++; route(s.will_topic, s.will_msg, s.will_retain); }
+}
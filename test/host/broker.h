@@ -0,0 +1,62 @@
+#pragma once
+// Минимальный MQTT 3.1.1 брокер в отдельном потоке — ровно то, что использует прошивка:
+// CONNECT (с LWT), SUBSCRIBE на точные топики, PUBLISH QoS0 с retain, PINGREQ, DISCONNECT.
+// Считает пакеты/байты на проводе; stop() «убивает» брокер без DISCONNECT, start() поднимает снова.
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BrokerStats {
+  uint32_t connects          = 0;
+  uint32_t packets           = 0;   // все пакеты от клиентов
+  uint32_t publishes         = 0;
+  uint32_t publish_bytes     = 0;   // PUBLISH целиком: фиксированный заголовок + остаток
+  uint32_t discovery_packets = 0;   // PUBLISH в homeassistant/...
+  uint32_t discovery_bytes   = 0;
+  uint32_t subscribes        = 0;
+  uint32_t pings             = 0;
+  uint32_t wills             = 0;   // LWT, опубликованные при обрыве
+  uint32_t accept_ms         = 0;   // millis() последнего TCP accept
+  uint32_t first_state_ms    = 0;   // millis() первого PUBLISH в state_topic после accept (0 = не было)
+  uint32_t last_publish_ms   = 0;
+};
+
+class MiniBroker {
+public:
+  ~MiniBroker() { stop(); }
+  bool start(uint16_t port);
+  void stop();
+  bool running() const { return thread_.joinable(); }
+
+  void        set_state_topic(const std::string& t);   // топик для first_state_ms
+  BrokerStats stats();
+  void        reset_stats();
+  std::string retained(const std::string& topic);
+
+private:
+  struct Session {
+    int                   fd = -1;
+    std::string           in;
+    std::vector<std::string> subs;
+    std::string           will_topic, will_msg;
+    bool                  will_retain = false;
+    bool                  has_will = false;
+  };
+
+  void run();
+  bool handle(Session& s, uint8_t hdr, const std::string& body, size_t wire_bytes);
+  void route(const std::string& topic, const std::string& payload, bool retain);
+  void drop(size_t i);
+
+  int                  listen_fd_ = -1;
+  int                  wake_[2]   = {-1, -1};
+  std::thread          thread_;
+  std::mutex           mu_;
+  std::vector<Session> sessions_;
+  std::map<std::string, std::string> retained_;
+  std::string          state_topic_;
+  BrokerStats          st_;
+};
@@ -0,0 +1,106 @@
+// Рантайм Arduino для хоста: время, Serial, POSIX WiFiClient
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <LittleFS.h>
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+HostSerial Serial;
+HostWiFi   WiFi;
+HostESP    ESP;
+HostFS     LittleFS;
+
+static const auto T0 = std::chrono::steady_clock::now();
+
+uint32_t millis() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - T0).count();
+}
+uint32_t micros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - T0).count();
+}
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void yield() { sched_yield(); }
+
+// ---------- WiFiClient ----------
+int WiFiClient::connect(const char* host, uint16_t port) {
+  stop();
+  addrinfo hints = {}, *res = nullptr;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  char ps[8]; snprintf(ps, sizeof(ps), "%u", port);
+  if (getaddrinfo(host, ps, &hints, &res) != 0 || !res) return 0;
+  int fd = socket(res->ai_family, SOCK_STREAM, 0);
+  if (fd < 0) { freeaddrinfo(res); return 0; }
+  // неблокирующий connect + poll: таймаут как у setTimeout() ядра
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  int rc = ::connect(fd, res->ai_addr, res->ai_addrlen);
+  freeaddrinfo(res);
+  if (rc < 0 && errno == EINPROGRESS) {
+    pollfd p = { fd, POLLOUT, 0 };
+    int err = 0; socklen_t len = sizeof(err);
+    if (poll(&p, 1, (int)timeout_ms_) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && !err) rc = 0;
+  }
+  if (rc < 0) { close(fd); return 0; }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+  fd_ = fd;
+  return 1;
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t n) {
+  if (fd_ < 0) return 0;
+  size_t done = 0;
+  while (done < n) {
+    ssize_t k = send(fd_, buf + done, n - done, MSG_NOSIGNAL);
+    if (k <= 0) { if (k < 0 && errno == EINTR) continue; break; }
+    done += (size_t)k;
+  }
+  return done;
+}
+
+int WiFiClient::available() {
+  if (fd_ < 0) return 0;
+  int n = 0;
+  return ioctl(fd_, FIONREAD, &n) == 0 ? n : 0;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t n) {
+  if (fd_ < 0) return -1;
+  ssize_t k = recv(fd_, buf, n, MSG_DONTWAIT);
+  return k > 0 ? (int)k : -1;
+}
+
+int WiFiClient::peek() {
+  uint8_t c;
+  return fd_ >= 0 && recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? c : -1;
+}
+
+void WiFiClient::stop() {
+  if (fd_ >= 0) { close(fd_); fd_ = -1; }
+}
+
+// Как у lwIP: непрочитанные данные держат соединение «живым», FIN без данных — разрыв
+uint8_t WiFiClient::connected() {
+  if (fd_ < 0) return 0;
+  uint8_t c;
+  ssize_t k = recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (k > 0) return 1;
+  if (k < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 1;
+  return 0;
+}
+
+void WiFiClient::setNoDelay(bool on) {
+  int v = on;
+  if (fd_ >= 0) setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &v, sizeof(v));
+}
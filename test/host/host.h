@@ -0,0 +1,13 @@
+#pragma once
+// «Железо» стенда: датчики, реле и АЦП, которыми бенчмарк двигает срез состояния
+#include <Arduino.h>
+
+struct HostPlant {
+  bool     s50       = false;
+  bool     s100      = false;
+  bool     relay     = false;
+  uint16_t analog_pm = 0;   // ‰
+};
+extern HostPlant plant;
+
+extern bool host_log_quiet;   // не печатать лог прошивки в stderr
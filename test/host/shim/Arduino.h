@@ -0,0 +1,169 @@
+#pragma once
+// Хостовый Arduino.h: ровно то, что нужно mqtt.cpp, state.cpp, PubSubClient и ArduinoJson.
+// String — поверх std::string; PROGMEM — обычная память; millis() — steady_clock.
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+using std::min;
+using std::max;
+
+uint32_t millis();
+uint32_t micros();
+void     delay(uint32_t ms);
+void     yield();
+
+// ---- PROGMEM: на хосте всё в RAM ----
+#define PROGMEM
+#define PGM_P              const char*
+#define PSTR(s)            (s)
+#define F(s)               (reinterpret_cast<const __FlashStringHelper*>(s))
+#define FPSTR(p)           (reinterpret_cast<const __FlashStringHelper*>(p))
+#define pgm_read_byte(p)   (*(const uint8_t*)(p))
+#define pgm_read_word(p)   (*(const uint16_t*)(p))
+#define pgm_read_dword(p)  (*(const uint32_t*)(p))
+#define pgm_read_ptr(p)    (*(void* const*)(p))
+#define memcpy_P           memcpy
+#define strlen_P           strlen
+#define strcmp_P           strcmp
+#define strncmp_P          strncmp
+#define snprintf_P         snprintf
+#define sprintf_P          sprintf
+class __FlashStringHelper;
+
+// ---- пины NodeMCU (для hardware.h) ----
+static const uint8_t D0 = 16, D1 = 5, D2 = 4, D3 = 0, D4 = 2, D5 = 14, D6 = 12, D7 = 13, D8 = 15;
+static const uint8_t LED_BUILTIN = 2;
+#define HEX 16
+#define DEC 10
+
+class String {
+public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  String(const __FlashStringHelper* s) : s_(reinterpret_cast<const char*>(s)) {}
+  explicit String(char c) : s_(1, c) {}
+  String(int v, unsigned char base = 10)           { num((long)v, base); }
+  String(unsigned v, unsigned char base = 10)      { unum(v, base); }
+  String(long v, unsigned char base = 10)          { num(v, base); }
+  String(unsigned long v, unsigned char base = 10) { unum(v, base); }
+  String(float v, unsigned char dec = 2)           { flt(v, dec); }
+  String(double v, unsigned char dec = 2)          { flt(v, dec); }
+
+  const char*  c_str() const     { return s_.c_str(); }
+  unsigned int length() const    { return (unsigned)s_.size(); }
+  bool         isEmpty() const   { return s_.empty(); }
+  bool         reserve(unsigned n) { s_.reserve(n); return true; }
+  char         operator[](unsigned i) const { return i < s_.size() ? s_[i] : 0; }
+  char&        operator[](unsigned i)       { return s_[i]; }
+  char         charAt(unsigned i) const     { return (*this)[i]; }
+
+  bool concat(const String& o) { s_ += o.s_; return true; }
+  bool concat(const char* o)   { if (o) s_ += o; return true; }
+  bool concat(const char* o, unsigned n) { s_.append(o, n); return true; }
+  bool concat(char c)          { s_ += c; return true; }
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const char* o)   { if (o) s_ += o; return *this; }
+  String& operator+=(const __FlashStringHelper* o) { s_ += reinterpret_cast<const char*>(o); return *this; }
+  String& operator+=(char c)          { s_ += c; return *this; }
+  String& operator+=(int v)           { s_ += String(v).s_; return *this; }
+  String& operator+=(unsigned v)      { s_ += String(v).s_; return *this; }
+
+  bool operator==(const String& o) const { return s_ == o.s_; }
+  bool operator==(const char* o) const   { return s_ == (o ? o : ""); }
+  bool operator!=(const String& o) const { return s_ != o.s_; }
+  bool operator!=(const char* o) const   { return !(*this == o); }
+  bool operator<(const String& o) const  { return s_ < o.s_; }
+
+  String substring(unsigned from) const { return from < s_.size() ? String(s_.substr(from)) : String(); }
+  String substring(unsigned from, unsigned to) const {
+    if (from > to) std::swap(from, to);
+    return from < s_.size() ? String(s_.substr(from, to - from)) : String();
+  }
+  bool startsWith(const String& p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+  bool endsWith(const String& p) const {
+    return s_.size() >= p.s_.size() && s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0;
+  }
+  int  indexOf(char c, unsigned from = 0) const { auto i = s_.find(c, from); return i == std::string::npos ? -1 : (int)i; }
+  void trim() {
+    size_t b = 0, e = s_.size();
+    while (b < e && isspace((unsigned char)s_[b])) b++;
+    while (e > b && isspace((unsigned char)s_[e - 1])) e--;
+    s_ = s_.substr(b, e - b);
+  }
+  void toLowerCase() { for (auto& c : s_) c = (char)tolower((unsigned char)c); }
+  void toUpperCase() { for (auto& c : s_) c = (char)toupper((unsigned char)c); }
+  long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(s_.c_str(), nullptr); }
+
+  const std::string& str() const { return s_; }
+
+private:
+  std::string s_;
+  void num(long v, unsigned char base) {
+    if (v < 0 && base == 10) { s_ = "-"; unum((unsigned long)(-v), base, true); }
+    else unum((unsigned long)v, base);
+  }
+  void unum(unsigned long v, unsigned char base, bool append = false) {
+    char b[33]; int i = 32; b[i] = 0;
+    do { int d = v % base; b[--i] = (char)(d < 10 ? '0' + d : 'A' + d - 10); v /= base; } while (v);
+    if (append) s_ += &b[i]; else s_ = &b[i];
+  }
+  void flt(double v, unsigned char dec) { char b[48]; snprintf(b, sizeof(b), "%.*f", dec, v); s_ = b; }
+};
+
+// Как в ядре: результат «+» — отдельный тип (ArduinoJson знает его как строку)
+class StringSumHelper : public String {
+public:
+  StringSumHelper(const String& s) : String(s) {}
+  StringSumHelper(const char* s) : String(s) {}
+};
+
+inline StringSumHelper operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline StringSumHelper operator+(const String& a, const char* b)   { String r(a); r += b; return r; }
+inline StringSumHelper operator+(const String& a, char b)          { String r(a); r += b; return r; }
+inline StringSumHelper operator+(const String& a, const __FlashStringHelper* b) { String r(a); r += b; return r; }
+inline StringSumHelper operator+(const char* a, const String& b)   { String r(a); r += b; return r; }
+inline bool operator==(const char* a, const String& b) { return b == a; }
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t n) { size_t i = 0; while (i < n && write(buf[i])) i++; return i; }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(const char* s)   { return write(s); }
+  size_t println(const char* s) { size_t n = write(s); return n + write("\n"); }
+  size_t println(const String& s) { return println(s.c_str()); }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void   setTimeout(unsigned long ms) { timeout_ms_ = ms; }
+  size_t readBytes(char* buf, size_t n) { size_t i = 0; int c; while (i < n && (c = read()) >= 0) buf[i++] = (char)c; return i; }
+  String readString() { String s; int c; while ((c = read()) >= 0) s += (char)c; return s; }
+protected:
+  unsigned long timeout_ms_ = 1000;
+};
+
+// Serial -> stderr: лог стенда не смешивается с отчётом в stdout
+class HostSerial : public Print {
+public:
+  void   begin(unsigned long) {}
+  size_t write(uint8_t c) override { return fputc(c, stderr) == EOF ? 0 : 1; }
+};
+extern HostSerial Serial;
@@ -0,0 +1,47 @@
+#pragma once
+// WiFiClient поверх POSIX-сокетов (блокирующий connect с таймаутом, неблокирующее чтение)
+// и заглушки WiFi/ESP с фиксированными MAC/IP/RSSI.
+#include "Arduino.h"
+#include "Client.h"
+#include "IPAddress.h"
+
+class WiFiClient : public Client {
+public:
+  WiFiClient() {}
+  ~WiFiClient() override { stop(); }
+  WiFiClient(const WiFiClient&) = delete;
+  WiFiClient& operator=(const WiFiClient&) = delete;
+
+  int     connect(IPAddress ip, uint16_t port) override { return connect(ip.toString().c_str(), port); }
+  int     connect(const char* host, uint16_t port) override;
+  size_t  write(uint8_t c) override { return write(&c, 1); }
+  size_t  write(const uint8_t* buf, size_t n) override;
+  int     available() override;
+  int     read() override { uint8_t c; return read(&c, 1) == 1 ? c : -1; }
+  int     read(uint8_t* buf, size_t n) override;
+  int     peek() override;
+  void    flush() override {}
+  void    stop() override;
+  uint8_t connected() override;
+  operator bool() override { return fd_ >= 0; }
+  void    setNoDelay(bool on);
+
+private:
+  int fd_ = -1;
+};
+
+class HostWiFi {
+public:
+  void      macAddress(uint8_t* m) const { static const uint8_t M[6] = {0x02, 0, 0, 0x12, 0x34, 0x56}; memcpy(m, M, 6); }
+  IPAddress localIP() const { return IPAddress(127, 0, 0, 1); }
+  int8_t    RSSI() const    { return -55; }
+};
+extern HostWiFi WiFi;
+
+class HostESP {
+public:
+  String   getResetReason() const { return String("Host"); }
+  uint32_t getChipId() const      { return 0x123456; }
+  uint32_t getFreeHeap() const    { return 40000; }
+};
+extern HostESP ESP;
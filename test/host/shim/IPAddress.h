@@ -0,0 +1,16 @@
+#pragma once
+#include "Arduino.h"
+
+class IPAddress {
+public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : b_{a, b, c, d} {}
+  uint8_t  operator[](int i) const { return b_[i]; }
+  uint8_t& operator[](int i)       { return b_[i]; }
+  String toString() const {
+    char s[16]; snprintf(s, sizeof(s), "%u.%u.%u.%u", b_[0], b_[1], b_[2], b_[3]);
+    return String(s);
+  }
+private:
+  uint8_t b_[4] = {0, 0, 0, 0};
+};
@@ -0,0 +1,22 @@
+#pragma once
+// Пустая ФС: CA для TLS на стенде нет, open() всегда не находит файл
+#include "Arduino.h"
+
+class File : public Stream {
+public:
+  explicit operator bool() const { return false; }
+  size_t write(uint8_t) override { return 0; }
+  int    available() override { return 0; }
+  int    read() override { return -1; }
+  int    peek() override { return -1; }
+  void   close() {}
+};
+
+class HostFS {
+public:
+  bool begin() { return true; }
+  File open(const char*, const char*) { return File(); }
+  bool exists(const char*) { return false; }
+  bool remove(const char*) { return false; }
+};
+extern HostFS LittleFS;
@@ -0,0 +1,30 @@
+#pragma once
+// BearSSL на хосте не собираем: стенд гоняет mqtt_tls=false, клиент ниже только для компиляции
+// и честно отказывает в соединении.
+#include "ESP8266WiFi.h"
+
+namespace BearSSL {
+
+struct Session {
+  uint8_t data[64] = {};
+};
+
+class X509List {
+public:
+  explicit X509List(const char*) {}
+  unsigned getCount() const { return 0; }
+};
+
+class WiFiClientSecure : public WiFiClient {
+public:
+  static bool probeMaxFragmentLength(const char*, uint16_t, uint16_t) { return false; }
+  int  connect(IPAddress, uint16_t) override { return 0; }
+  int  connect(const char*, uint16_t) override { return 0; }
+  void setBufferSizes(int, int) {}
+  void setSession(Session*) {}
+  void setTrustAnchors(const X509List*) {}
+  bool setFingerprint(const char*) { return false; }
+  int  getLastSSLError() const { return -1; }
+};
+
+}  // namespace BearSSL
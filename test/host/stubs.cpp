@@ -0,0 +1,64 @@
+// Заглушки модулей прошивки, от которых зависят mqtt.cpp и state.cpp.
+// Конфиг — значения по умолчанию из config.h, датчики и реле — из plant.
+#include "host.h"
+#include "config.h"
+#include "sensors.h"
+#include "relay.h"
+#include "power.h"
+#include "analog.h"
+#include "log.h"
+#include "failsafe.h"
+#include "timesync.h"
+#include "rtcstate.h"
+
+Config    cfg;
+HostPlant plant;
+bool      host_log_quiet = false;
+
+bool saveConfig() { return true; }
+
+bool     sensors_s50()                 { return plant.s50; }
+bool     sensors_s100()                { return plant.s100; }
+int      sensors_level()               { return plant.s100 ? 100 : (plant.s50 ? 50 : 0); }
+bool     sensors_error()               { return plant.s100 && !plant.s50; }
+uint16_t sensors_rate_x10()            { return 200; }
+uint32_t sensors_confirm_ms(bool)      { return cfg.sample_ms * cfg.confirm_samples; }
+
+void relay_set(bool on) { plant.relay = on; }
+bool relay_get()        { return plant.relay; }
+
+bool     analog_enabled()  { return cfg.analog_enabled; }
+uint16_t analog_permille() { return plant.analog_pm; }
+uint32_t analog_litres()   { return (uint64_t)cfg.tank_litres * plant.analog_pm / 1000; }
+
+bool     power_active()    { return false; }
+uint8_t  power_awake_pct() { return 100; }
+uint32_t power_est_ua()    { return 0; }
+
+uint32_t failsafe_trips()    { return 0; }
+uint32_t failsafe_worst_us() { return 0; }
+
+bool     timesync_synced()    { return false; }
+uint32_t timesync_syncs()     { return 0; }
+int32_t  timesync_offset_ms() { return 0; }
+int32_t  timesync_drift_ppm() { return 0; }
+void     timesync_format_ms(char* buf, size_t len) { snprintf(buf, len, "0"); }
+
+uint32_t rtcstate_warm_boots() { return 0; }
+uint32_t rtcstate_cold_boots() { return 1; }
+
+// Лог: аргументы на ESP — 32-битные, указатели на хосте в них не влезают.
+// Формат со строками печатаем как есть, числовой — с подстановкой.
+static uint32_t s_log_n = 0;
+void log_push(uint8_t level, PGM_P fmt, const uint32_t* a, uint8_t) {
+  s_log_n++;
+  if (host_log_quiet) return;
+  static const char LVL[] = "-EWID";
+  fprintf(stderr, "%8u %c ", (unsigned)millis(), LVL[level < 5 ? level : 0]);
+  if (strstr(fmt, "%s")) fputs(fmt, stderr);
+  else                   fprintf(stderr, fmt, a[0], a[1], a[2], a[3]);
+  fputc('\n', stderr);
+}
+uint32_t log_head() { return s_log_n; }
+uint32_t log_tail() { return s_log_n; }
+bool     log_format(uint32_t, char*, size_t) { return false; }
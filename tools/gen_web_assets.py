@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+"""Генерирует include/web_assets.h из web/*.css (gzip -9, mtime=0).
+
+Запуск из корня проекта:  python3 tools/gen_web_assets.py
+VER/ETag = первые 8 hex md5 от исходника — меняется только при правке CSS.
+"""
+import gzip
+import hashlib
+import pathlib
+
+ROOT = pathlib.Path(__file__).resolve().parent.parent
+ASSETS = [
+    # (файл, имя массива, URL)
+    ("web/style.css", "STYLE_CSS", "/style.css"),
+]
+
+
+def minify_css(src: str) -> str:
+    return "".join(line.strip() for line in src.splitlines())
+
+
+def main() -> None:
+    out = [
+        "#pragma once",
+        "// СГЕНЕРИРОВАНО tools/gen_web_assets.py — не править руками.",
+        "#include <Arduino.h>",
+        "",
+    ]
+    for rel, name, url in ASSETS:
+        raw = minify_css((ROOT / rel).read_text(encoding="utf-8")).encode()
+        gz = gzip.compress(raw, 9, mtime=0)
+        etag = hashlib.md5(raw).hexdigest()[:8]
+        out.append(f"// {rel}: {len(raw)} B -> gzip {len(gz)} B")
+        out.append(f'static const char {name}_URL[]  = "{url}";')
+        out.append(f'static const char {name}_VER[]  = "{etag}";  // ETag и ?v= в ссылке')
+        out.append(f"static const size_t {name}_GZ_LEN = {len(gz)};")
+        out.append(f"static const uint8_t {name}_GZ[] PROGMEM = {{")
+        for i in range(0, len(gz), 16):
+            out.append("  " + ",".join(f"0x{b:02x}" for b in gz[i:i + 16]) + ",")
+        out.append("};")
+        out.append("")
+    (ROOT / "include/web_assets.h").write_text("\n".join(out), encoding="utf-8")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""Нагрузочный тест веб-интерфейса контроллера с хоста.
+
+Запуск:  python3 tools/http_load.py 192.168.1.50 -c 8 -d 20 [--slow 2]
+N клиентов (-c) по кругу дёргают существующие GET-маршруты в течение -d секунд,
+каждый запрос — новое соединение (как браузер к ESP). --slow K добавляет K
+«медленных» клиентов, которые тянут заголовки запроса по байту в полсекунды:
+синхронный ESP8266WebServer на них встаёт, асинхронный (env nodemcuv2_async) — нет.
+Итог: запросов/с, p50/p90/p99/max латентности по маршрутам, 503 (отказ по лимиту)
+и ошибки. Только стандартная библиотека.
+"""
+import argparse
+import base64
+import http.client
+import socket
+import threading
+import time
+
+ROUTES = ["/", "/style.css", "/mqtt/stats", "/log", "/settings"]
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.lat = {}      # маршрут -> [мс]
+        self.busy = {}     # маршрут -> число 503
+        self.errors = {}   # маршрут -> число ошибок
+
+    def add(self, route, ms=None, busy=False, error=False):
+        with self.lock:
+            if error:
+                self.errors[route] = self.errors.get(route, 0) + 1
+            elif busy:
+                self.busy[route] = self.busy.get(route, 0) + 1
+            else:
+                self.lat.setdefault(route, []).append(ms)
+
+
+def pct(sorted_ms, p):
+    if not sorted_ms:
+        return 0.0
+    return sorted_ms[min(len(sorted_ms) - 1, int(len(sorted_ms) * p / 100))]
+
+
+def worker(args, headers, stop, stats, offset):
+    i = offset
+    while not stop.is_set():
+        route = args.routes[i % len(args.routes)]
+        i += 1
+        t0 = time.monotonic()
+        try:
+            conn = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+            conn.request("GET", route, headers=headers)
+            resp = conn.getresponse()
+            resp.read()
+            conn.close()
+        except (OSError, http.client.HTTPException):
+            stats.add(route, error=True)
+            continue
+        ms = (time.monotonic() - t0) * 1000
+        if resp.status == 503:
+            stats.add(route, busy=True)
+        elif resp.status in (200, 304):
+            stats.add(route, ms)
+        else:
+            stats.add(route, error=True)
+
+
+def slow_client(args, stop):
+    req = f"GET /mqtt/stats HTTP/1.1\r\nHost: {args.host}\r\n\r\n".encode()
+    while not stop.is_set():
+        try:
+            s = socket.create_connection((args.host, args.port), timeout=args.timeout)
+            for b in req:
+                if stop.is_set():
+                    break
+                s.send(bytes([b]))
+                time.sleep(0.5)
+            s.close()
+        except OSError:
+            time.sleep(0.5)
+
+
+def main() -> None:
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("host")
+    ap.add_argument("--port", type=int, default=80)
+    ap.add_argument("-c", "--concurrency", type=int, default=4)
+    ap.add_argument("-d", "--duration", type=float, default=10.0, help="секунд")
+    ap.add_argument("--slow", type=int, default=0, help="медленных клиентов")
+    ap.add_argument("--timeout", type=float, default=10.0, help="таймаут запроса, с")
+    ap.add_argument("--auth", help="user:pass для Basic (web_user/web_pass)")
+    ap.add_argument("--routes", nargs="+", default=ROUTES)
+    args = ap.parse_args()
+
+    headers = {"Connection": "close"}
+    if args.auth:
+        headers["Authorization"] = "Basic " + base64.b64encode(args.auth.encode()).decode()
+
+    stop = threading.Event()
+    stats = Stats()
+    threads = [threading.Thread(target=slow_client, args=(args, stop), daemon=True)
+               for _ in range(args.slow)]
+    threads += [threading.Thread(target=worker, args=(args, headers, stop, stats, n), daemon=True)
+                for n in range(args.concurrency)]
+    t0 = time.monotonic()
+    for t in threads:
+        t.start()
+    time.sleep(args.duration)
+    stop.set()
+    for t in threads:
+        t.join(args.timeout + 1)
+    elapsed = time.monotonic() - t0
+
+    print(f"{args.host}:{args.port}  c={args.concurrency} slow={args.slow}  {elapsed:.1f} s")
+    print(f"{'route':<14}{'ok':>7}{'503':>6}{'err':>6}{'p50':>9}{'p90':>9}{'p99':>9}{'max':>9}  ms")
+    every = []
+    for route in args.routes:
+        ms = sorted(stats.lat.get(route, []))
+        every += ms
+        print(f"{route:<14}{len(ms):>7}{stats.busy.get(route, 0):>6}{stats.errors.get(route, 0):>6}"
+              f"{pct(ms, 50):>9.1f}{pct(ms, 90):>9.1f}{pct(ms, 99):>9.1f}{(ms[-1] if ms else 0):>9.1f}")
+    every.sort()
+    busy = sum(stats.busy.values())
+    errors = sum(stats.errors.values())
+    print(f"{'total':<14}{len(every):>7}{busy:>6}{errors:>6}"
+          f"{pct(every, 50):>9.1f}{pct(every, 90):>9.1f}{pct(every, 99):>9.1f}{(every[-1] if every else 0):>9.1f}")
+    print(f"{len(every) / elapsed:.1f} req/s")
+
+
+if __name__ == "__main__":
+    main()